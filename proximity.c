@@ -69,6 +69,8 @@
 #include "stdio.h"
 #include "platform.h"
 #include "sparcommon.h"
+#include "bleapputils.h"
+#include "proximity.h"
 
 
 
@@ -84,6 +86,10 @@ PLACE_IN_DROM const UINT8 proximity_db_data[]=
     CHARACTERISTIC_UUID16  (0x0002, 0x0003, UUID_CHARACTERISTIC_SERVICE_CHANGED, LEGATTDB_CHAR_PROP_INDICATE, LEGATTDB_PERM_NONE, 4),
         0x00, 0x00, 0x00, 0x00,
 
+    CHAR_DESCRIPTOR_UUID16_WRITABLE (HANDLE_PROX_SERVICE_CHANGED_CFG_DESC, UUID_DESCRIPTOR_CLIENT_CHARACTERISTIC_CONFIGURATION,
+                                     LEGATTDB_PERM_READABLE | LEGATTDB_PERM_WRITE_REQ, 2),
+        0x00,0x00,
+
     // GAP service
     PRIMARY_SERVICE_UUID16 (0x0014, UUID_SERVICE_GAP),
 
@@ -166,6 +172,96 @@ PLACE_IN_DROM const UINT8 proximity_db_data[]=
     CHAR_DESCRIPTOR_UUID16_WRITABLE (0x004D, UUID_DESCRIPTOR_SERVER_CHARACTERISTIC_CONFIGURATION,
                                      LEGATTDB_PERM_READABLE | LEGATTDB_PERM_WRITE_CMD |LEGATTDB_PERM_WRITE_REQ, 2),
         0x00,0x00,
+
+#ifdef OTA_FW_UPGRADE
+    // Vendor specific OTA firmware upgrade service
+    PRIMARY_SERVICE_UUID128 (HANDLE_PROX_OTA_SERVICE, UUID_PROX_OTA_SERVICE),
+
+    CHARACTERISTIC_UUID128_WRITABLE (HANDLE_PROX_OTA_CHAR_CONTROL_POINT, HANDLE_PROX_OTA_CONTROL_POINT_VALUE,
+                                     UUID_PROX_OTA_CONTROL_POINT,
+                                     LEGATTDB_CHAR_PROP_WRITE | LEGATTDB_CHAR_PROP_NOTIFY,
+                                     LEGATTDB_PERM_VARIABLE_LENGTH | LEGATTDB_PERM_WRITE_REQ, 9),
+        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+
+    CHAR_DESCRIPTOR_UUID16_WRITABLE (HANDLE_PROX_OTA_CONTROL_POINT_CFG_DESC, UUID_DESCRIPTOR_CLIENT_CHARACTERISTIC_CONFIGURATION,
+                                     LEGATTDB_PERM_READABLE | LEGATTDB_PERM_WRITE_REQ, 2),
+        0x00,0x00,
+
+    CHARACTERISTIC_UUID128_WRITABLE (HANDLE_PROX_OTA_CHAR_DATA, HANDLE_PROX_OTA_DATA_VALUE,
+                                     UUID_PROX_OTA_DATA,
+                                     LEGATTDB_CHAR_PROP_WRITE_NO_RESPONSE,
+                                     LEGATTDB_PERM_VARIABLE_LENGTH | LEGATTDB_PERM_WRITE_CMD, PROXIMITY_OTA_DATA_PACKET_SIZE),
+        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+#endif
+
+    // Vendor specific diagnostics service
+    PRIMARY_SERVICE_UUID128 (HANDLE_PROX_DIAG_SERVICE, UUID_PROX_DIAG_SERVICE),
+
+    CHARACTERISTIC_UUID128_WRITABLE (HANDLE_PROX_DIAG_CHAR_METRICS, HANDLE_PROX_DIAG_METRICS_VALUE,
+                                     UUID_PROX_DIAG_METRICS,
+                                     LEGATTDB_CHAR_PROP_WRITE | LEGATTDB_CHAR_PROP_NOTIFY,
+                                     LEGATTDB_PERM_WRITE_REQ, 1),
+        0x00,
+
+    CHAR_DESCRIPTOR_UUID16_WRITABLE (HANDLE_PROX_DIAG_METRICS_CFG_DESC, UUID_DESCRIPTOR_CLIENT_CHARACTERISTIC_CONFIGURATION,
+                                     LEGATTDB_PERM_READABLE | LEGATTDB_PERM_WRITE_REQ, 2),
+        0x00,0x00,
+
+    CHARACTERISTIC_UUID128 (HANDLE_PROX_DIAG_CHAR_MEMORY, HANDLE_PROX_DIAG_MEMORY_VALUE,
+                            UUID_PROX_DIAG_MEMORY,
+                            LEGATTDB_CHAR_PROP_READ | LEGATTDB_CHAR_PROP_NOTIFY,
+                            LEGATTDB_PERM_READABLE, PROXIMITY_DIAG_MEMORY_SIZE),
+        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+
+    CHAR_DESCRIPTOR_UUID16_WRITABLE (HANDLE_PROX_DIAG_MEMORY_CFG_DESC, UUID_DESCRIPTOR_CLIENT_CHARACTERISTIC_CONFIGURATION,
+                                     LEGATTDB_PERM_READABLE | LEGATTDB_PERM_WRITE_REQ, 2),
+        0x00,0x00,
+
+    CHARACTERISTIC_UUID128 (HANDLE_PROX_DIAG_CHAR_LINK, HANDLE_PROX_DIAG_LINK_VALUE,
+                            UUID_PROX_DIAG_LINK,
+                            LEGATTDB_CHAR_PROP_READ, LEGATTDB_PERM_READABLE, PROXIMITY_LINK_STATS_SIZE),
+        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+
+    // CRC32 of this database as built, filled in at start up.  Clients that cached
+    // the handles read this value instead of running service discovery again.
+    CHARACTERISTIC_UUID128 (HANDLE_PROX_DIAG_CHAR_HANDLE_MAP_ID, HANDLE_PROX_DIAG_HANDLE_MAP_ID_VALUE,
+                            UUID_PROX_DIAG_HANDLE_MAP_ID,
+                            LEGATTDB_CHAR_PROP_READ, LEGATTDB_PERM_READABLE, 4),
+        0x00,0x00,0x00,0x00,
+
+    // Vendor specific signed alert service, see proximity_signed_alert.c.  The
+    // signing key can only be written on an encrypted link with a bonded peer,
+    // this is checked through the secure mask of the write dispatch table so
+    // that the error is reported to the client.
+    PRIMARY_SERVICE_UUID128 (HANDLE_PROX_SIGNED_ALERT_SERVICE, UUID_PROX_SIGNED_ALERT_SERVICE),
+
+    CHARACTERISTIC_UUID128_WRITABLE (HANDLE_PROX_SIGNED_ALERT_CHAR_KEY, HANDLE_PROX_SIGNED_ALERT_KEY_VALUE,
+                                     UUID_PROX_SIGNED_ALERT_KEY,
+                                     LEGATTDB_CHAR_PROP_WRITE,
+                                     LEGATTDB_PERM_VARIABLE_LENGTH | LEGATTDB_PERM_WRITE_REQ, 16),
+        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+
+    CHARACTERISTIC_UUID128_WRITABLE (HANDLE_PROX_SIGNED_ALERT_CHAR_ALERT, HANDLE_PROX_SIGNED_ALERT_VALUE,
+                                     UUID_PROX_SIGNED_ALERT_LEVEL,
+                                     LEGATTDB_CHAR_PROP_WRITE_NO_RESPONSE,
+                                     LEGATTDB_PERM_VARIABLE_LENGTH | LEGATTDB_PERM_WRITE_CMD, PROXIMITY_SIGNED_ALERT_SIZE),
+        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+
+    // Vendor specific configuration service, see proximity_config.c
+    PRIMARY_SERVICE_UUID128 (HANDLE_PROX_CONFIG_SERVICE, UUID_PROX_CONFIG_SERVICE),
+
+    CHARACTERISTIC_UUID128_WRITABLE (HANDLE_PROX_CONFIG_CHAR_CONTROL_POINT, HANDLE_PROX_CONFIG_CONTROL_POINT_VALUE,
+                                     UUID_PROX_CONFIG_CONTROL_POINT,
+                                     LEGATTDB_CHAR_PROP_WRITE,
+                                     LEGATTDB_PERM_VARIABLE_LENGTH | LEGATTDB_PERM_WRITE_REQ, 19),
+        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+
+    CHARACTERISTIC_UUID128 (HANDLE_PROX_CONFIG_CHAR_VALUE, HANDLE_PROX_CONFIG_VALUE,
+                            UUID_PROX_CONFIG_VALUE,
+                            LEGATTDB_CHAR_PROP_READ, LEGATTDB_PERM_READABLE, PROXIMITY_CONFIG_VALUE_SIZE),
+        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -202,12 +298,383 @@ const BLE_PROFILE_GPIO_CFG bleprox_gpio_cfg =
     }
 };
 
+// CRC32 (IEEE 802.3) nibble table, keeps the code small without a 1K table
+static const UINT32 proximity_crc32_table[16] =
+{
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+// Notifications sent in the current fine timer tick
+UINT8 proximity_notifications_queued;
+
+// NVRAM writes done by the application since power up
+UINT32 proximity_nvram_writes;
+UINT32 proximity_nvram_bytes;
+
+// Set when encryption of the link succeeded, LE encryption stays on until
+// the link goes down
+BOOL32 proximity_link_encrypted;
+
+// Encryption Change event: status (1), connection handle (2), enabled (1).
+// Key Refresh Complete carries status and handle only.
+#define PROXIMITY_HCI_EVT_ENCRYPTION_CHANGE     0x08
+
+// Write handlers of the services added by the application.  Every service
+// starts at its own block of 16 handles, so the block number of a handle
+// selects the handler with a single table lookup however many services are
+// added.  The mask has a bit per handle of the block that can only be
+// written on an encrypted link with a bonded peer.
+typedef struct
+{
+    int     (*handler)(LEGATTDB_ENTRY_HDR *p);
+    UINT16  secure;
+} PROXIMITY_WRITE_DISPATCH;
+
+#define PROXIMITY_HANDLE_BLOCK(handle)          ((handle) >> 4)
+#define PROXIMITY_WRITE_DISPATCH_BLOCKS         (PROXIMITY_HANDLE_BLOCK(HANDLE_PROX_CONFIG_LAST) + 1)
+#define PROXIMITY_ERR_INSUFFICIENT_AUTHENTICATION   0x05
+#define PROXIMITY_ERR_INSUFFICIENT_ENCRYPTION       0x0f
+
+// Build fails here if a service outgrows its block
+#define PROXIMITY_ASSERT_BLOCK(first, last)     typedef char proximity_block_##first[(PROXIMITY_HANDLE_BLOCK(first) == PROXIMITY_HANDLE_BLOCK(last)) ? 1 : -1]
+PROXIMITY_ASSERT_BLOCK(HANDLE_PROX_OTA_SERVICE, HANDLE_PROX_OTA_LAST);
+PROXIMITY_ASSERT_BLOCK(HANDLE_PROX_DIAG_SERVICE, HANDLE_PROX_DIAG_LAST);
+PROXIMITY_ASSERT_BLOCK(HANDLE_PROX_SIGNED_ALERT_SERVICE, HANDLE_PROX_SIGNED_ALERT_LAST);
+PROXIMITY_ASSERT_BLOCK(HANDLE_PROX_CONFIG_SERVICE, HANDLE_PROX_CONFIG_LAST);
+
+// Handles of the database must ascend, services are declared in this order
+#define PROXIMITY_ASSERT_ORDER(last, next)      typedef char proximity_order_##next[(PROXIMITY_HANDLE_BLOCK(last) < PROXIMITY_HANDLE_BLOCK(next)) ? 1 : -1]
+PROXIMITY_ASSERT_ORDER(HANDLE_PROX_BATTERY_LEVEL_STATE_SCCD, HANDLE_PROX_OTA_SERVICE);
+PROXIMITY_ASSERT_ORDER(HANDLE_PROX_OTA_LAST, HANDLE_PROX_DIAG_SERVICE);
+PROXIMITY_ASSERT_ORDER(HANDLE_PROX_DIAG_LAST, HANDLE_PROX_SIGNED_ALERT_SERVICE);
+PROXIMITY_ASSERT_ORDER(HANDLE_PROX_SIGNED_ALERT_LAST, HANDLE_PROX_CONFIG_SERVICE);
+
+static const PROXIMITY_WRITE_DISPATCH proximity_write_dispatch[PROXIMITY_WRITE_DISPATCH_BLOCKS] =
+{
+    { proximity_service_changed_write_handler, 0 }, // 0x0000, GATT
+    { NULL, 0 },                                    // 0x0010, GAP
+    { NULL, 0 },                                    // 0x0020, Link Loss, Immediate Alert
+    { NULL, 0 },                                    // 0x0030, TX Power, Battery
+    { NULL, 0 },                                    // 0x0040
+    { NULL, 0 },                                    // 0x0050
+#ifdef OTA_FW_UPGRADE
+    { proximity_ota_write_handler,                  // 0x0060
+      (1 << (HANDLE_PROX_OTA_CONTROL_POINT_VALUE & 0x0f)) |
+      (1 << (HANDLE_PROX_OTA_CONTROL_POINT_CFG_DESC & 0x0f)) |
+      (1 << (HANDLE_PROX_OTA_DATA_VALUE & 0x0f)) },
+#else
+    { NULL, 0 },
+#endif
+    { proximity_metrics_write_handler, 0 },         // 0x0070
+    { proximity_signed_alert_write_handler,         // 0x0080
+      1 << (HANDLE_PROX_SIGNED_ALERT_KEY_VALUE & 0x0f) },
+    { proximity_config_write_handler,               // 0x0090
+      1 << (HANDLE_PROX_CONFIG_CONTROL_POINT_VALUE & 0x0f) },
+};
+
+
+UINT32 proximity_crc32(UINT32 crc, UINT8 *p, UINT16 len)
+{
+    while (len--)
+    {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ proximity_crc32_table[crc & 0x0f];
+        crc = (crc >> 4) ^ proximity_crc32_table[crc & 0x0f];
+    }
+    return crc;
+}
+
+// Publish the id of the handle map so that clients can validate their cache
+static void proximity_set_handle_map_id(void)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+    UINT32 id = proximity_crc32(0xffffffff, (UINT8 *)proximity_db_data, sizeof(proximity_db_data)) ^ 0xffffffff;
+
+    db_pdu.len = 4;
+    proximity_tlv_put32(db_pdu.pdu, id);
+    bleprofile_WriteHandle(HANDLE_PROX_DIAG_HANDLE_MAP_ID_VALUE, &db_pdu);
 
+    ble_trace1("handle map id:%08x\n", id);
+}
+
+// Send notification if the client enabled it in the configuration descriptor
+BOOL32 proximity_send_notification(UINT16 cfg_handle, UINT16 handle, UINT8 *p, UINT8 len)
+{
+    BLEPROFILE_DB_PDU db_cl_pdu;
+
+    bleprofile_ReadHandle(cfg_handle, &db_cl_pdu);
+    if ((db_cl_pdu.len != 2) || !(db_cl_pdu.pdu[0] & 0x01))
+        return FALSE;
+
+    bleprofile_sendNotification(handle, p, len);
+    proximity_link_data_tx();
+
+    proximity_diag_pool_use(PROXIMITY_POOL_NOTIFICATION, ++proximity_notifications_queued);
+    return TRUE;
+}
+
+// Write application data to NVRAM, counting the writes for the wear metrics
+UINT8 proximity_write_nvram(UINT8 vs_id, UINT8 len, UINT8 *p)
+{
+    proximity_nvram_writes++;
+    proximity_nvram_bytes += len;
+
+    return bleprofile_WriteNVRAM(vs_id, len, p);
+}
+
+void proximity_nvram_add_metrics(PROXIMITY_TLV_WRITER *p_tlv)
+{
+    UINT8 *p = proximity_tlv_add(p_tlv, PROXIMITY_TLV_NVRAM, PROXIMITY_TLV_NVRAM_SIZE);
+
+    if (p != NULL)
+    {
+        proximity_tlv_put32(&p[0], proximity_nvram_writes);
+        proximity_tlv_put32(&p[4], proximity_nvram_bytes);
+    }
+}
+
+// Process write request or command from the peer. Attributes of the services
+// added by this application are handled here, the rest go to the ROM handler.
+int proximity_write_handler(LEGATTDB_ENTRY_HDR *p)
+{
+    UINT16 handle = legattdb_getHandle(p);
+    const PROXIMITY_WRITE_DISPATCH *p_dispatch = NULL;
+    int    result;
+    PROXIMITY_PROBE_START(start);
+
+    proximity_link_data_rx();
+
+    if (PROXIMITY_HANDLE_BLOCK(handle) < PROXIMITY_WRITE_DISPATCH_BLOCKS)
+    {
+        p_dispatch = &proximity_write_dispatch[PROXIMITY_HANDLE_BLOCK(handle)];
+    }
+
+    if ((p_dispatch != NULL) && (p_dispatch->handler != NULL))
+    {
+        if ((p_dispatch->secure & (1 << (handle & 0x0f))) && !proximity_link_encrypted)
+            result = PROXIMITY_ERR_INSUFFICIENT_ENCRYPTION;
+        else if ((p_dispatch->secure & (1 << (handle & 0x0f))) && !emconninfo_deviceBonded())
+            result = PROXIMITY_ERR_INSUFFICIENT_AUTHENTICATION;
+        else
+            result = p_dispatch->handler(p);
+    }
+#ifdef PROXIMITY_SIGNED_ALERT_REQUIRED
+    else if (handle == HANDLE_PROX_IMMEDIATE_ALERT_LEVEL)
+    {
+        // only signed alerts are accepted
+        result = 0;
+    }
+#endif
+    else if (handle == HANDLE_PROX_IMMEDIATE_ALERT_LEVEL)
+    {
+        result = proximity_ias_write(p);
+    }
+    else
+    {
+        result = bleprox_writeCb(p);
+
+        proximity_shadow_write(handle, legattdb_getAttrValue(p), legattdb_getAttrValueLen(p));
+    }
+
+    PROXIMITY_PROBE_STOP(PROXIMITY_PROBE_WRITE, start);
+    return result;
+}
+
+// This function is invoked when connection is established
+void proximity_connection_up(void)
+{
+    PROXIMITY_PROBE_START(start);
+
+    bleprox_connUp();
+
+    proximity_link_connection_up();
+
+    proximity_event_post(PROXIMITY_EVENT_CONNECTION_UP, 0);
+
+    PROXIMITY_PROBE_STOP(PROXIMITY_PROBE_CONNECTION_UP, start);
+}
+
+// This function is invoked when connection is lost
+void proximity_connection_down(void)
+{
+    PROXIMITY_PROBE_START(start);
+
+    bleprox_connDown();
+
+    proximity_link_encrypted = FALSE;
+    proximity_ias_connection_down();
+    proximity_config_connection_down();
+
+    proximity_event_post(PROXIMITY_EVENT_CONNECTION_DOWN, 0);
+
+    PROXIMITY_PROBE_STOP(PROXIMITY_PROBE_CONNECTION_DOWN, start);
+}
+
+// This function is invoked when advertisements stop
+void proximity_advertisement_stopped(void)
+{
+    PROXIMITY_PROBE_START(start);
+
+    bleprox_advStop();
+
+    PROXIMITY_PROBE_STOP(PROXIMITY_PROBE_ADV_STOP, start);
+}
+
+// One second timer
+void proximity_timeout(UINT32 count)
+{
+    PROXIMITY_PROBE_START(start);
+
+    bleprox_Timeout(count);
+
+    proximity_event_post(PROXIMITY_EVENT_TIMEOUT, 1);
+
+    PROXIMITY_PROBE_STOP(PROXIMITY_PROBE_TIMEOUT, start);
+}
+
+// Fine timer, period is configured in bleprox_cfg.  Notification pacing of
+// the metrics blob is tied to the tick and runs here.
+void proximity_fine_timeout(UINT32 finecount)
+{
+    PROXIMITY_PROBE_START(start);
+
+    bleprox_FineTimeout(finecount);
+
+    proximity_notifications_queued = 0;
+
+    proximity_metrics_fine_timeout();
+    proximity_ias_fine_timeout();
+    proximity_event_fine_timeout();
+    proximity_gpio_fine_timeout();
+
+    PROXIMITY_PROBE_STOP(PROXIMITY_PROBE_FINE_TIMEOUT, start);
+}
+
+// Pairing complete
+void proximity_smp_bond_result(LESMP_PARING_RESULT result)
+{
+    UINT32 start_clk = bleapputils_currentNativeBtClk();
+    PROXIMITY_PROBE_START(start);
+
+    bleprox_smpBondResult(result);
+
+    proximity_event_post(PROXIMITY_EVENT_BOND_RESULT, start_clk);
+
+    PROXIMITY_PROBE_STOP(PROXIMITY_PROBE_BOND_RESULT, start);
+}
+
+// Link encryption enabled or disabled
+void proximity_encryption_changed(HCI_EVT_HDR *evt)
+{
+    UINT8 *p = (UINT8 *)(evt + 1);
+    PROXIMITY_PROBE_START(start);
+
+    bleprox_encryptionChanged(evt);
+
+    // Failed attempt or encryption turned off
+    proximity_link_encrypted = (p[0] == 0) &&
+        ((evt->code != PROXIMITY_HCI_EVT_ENCRYPTION_CHANGE) || (evt->len < 4) || (p[3] != 0));
+
+    if (proximity_link_encrypted)
+    {
+        proximity_event_post(PROXIMITY_EVENT_ENCRYPTION_CHANGED, emconninfo_deviceBonded());
+    }
+
+    PROXIMITY_PROBE_STOP(PROXIMITY_PROBE_ENCRYPTION_CHANGED, start);
+}
+
+static void proximity_event_connection_up(PROXIMITY_EVENT *p_event)
+{
+    proximity_diag_connection_up();
+    proximity_adv_resume();
+    proximity_pairing_connection_up(p_event->clk);
+    proximity_signed_alert_connection_up();
+    proximity_config_connection_up();
+}
+
+static void proximity_event_connection_down(PROXIMITY_EVENT *p_event)
+{
+    proximity_link_connection_down();
+    proximity_metrics_connection_down();
+    proximity_signed_alert_connection_down();
+    proximity_service_changed_connection_down();
+    proximity_shadow_flush();
+    proximity_adv_resume();
+
+#ifdef OTA_FW_UPGRADE
+    proximity_ota_connection_down();
+#endif
+}
+
+static void proximity_event_encryption_changed(PROXIMITY_EVENT *p_event)
+{
+    proximity_pairing_encryption_changed(p_event->param, p_event->clk);
+    proximity_service_changed_encryption_changed(p_event->param);
+}
+
+static void proximity_event_bond_result(PROXIMITY_EVENT *p_event)
+{
+    proximity_pairing_bond_result(p_event->param, p_event->clk);
+    proximity_service_changed_bond_result();
+}
+
+static void proximity_event_timeout(PROXIMITY_EVENT *p_event)
+{
+    UINT32 ticks;
+
+    for (ticks = 0; ticks < p_event->param; ticks++)
+        proximity_timer_timeout();
+}
+
+// Handlers of the events posted by the callbacks above, in the order of the event types
+const PROXIMITY_EVENT_HANDLER proximity_event_handlers[PROXIMITY_EVENT_MAX] =
+{
+    proximity_event_connection_up,
+    proximity_event_connection_down,
+    proximity_event_encryption_changed,
+    proximity_event_bond_result,
+    proximity_event_timeout,
+};
+
+// Create the ROM proximity application and hook the application extensions
+// in front of the ROM callbacks.
+void proximity_create(void)
+{
+    proximity_diag_init();
+    proximity_probe_init();
+    proximity_metrics_init();
+    proximity_config_init();
+
+    bleprox_Create();
+
+    proximity_shadow_init();
+    proximity_adv_init();
+    proximity_set_handle_map_id();
+    proximity_service_changed_init(proximity_db_data, sizeof(proximity_db_data));
+    proximity_signed_alert_init();
+    proximity_sleep_init();
+    proximity_gpio_init();
+
+#ifdef OTA_FW_UPGRADE
+    proximity_ota_init();
+#endif
+
+    bleprofile_regAppEvtHandler(BLECM_APP_EVT_LINK_UP, proximity_connection_up);
+    bleprofile_regAppEvtHandler(BLECM_APP_EVT_LINK_DOWN, proximity_connection_down);
+    bleprofile_regAppEvtHandler(BLECM_APP_EVT_ADV_TIMEOUT, proximity_advertisement_stopped);
+    blecm_regEncryptionChangedHandler(proximity_encryption_changed);
+    lesmp_regSMPResultCb((LESMP_SINGLE_PARAM_CB)proximity_smp_bond_result);
+    legattdb_regWriteHandleCb((LEGATTDB_WRITE_CB)proximity_write_handler);
+    bleprofile_regTimerCb(proximity_fine_timeout, proximity_timeout);
+}
 
 APPLICATION_INIT()
 {
-    bleapp_set_cfg((UINT8 *)proximity_db_data, sizeof(proximity_db_data), (void *)&bleprox_cfg,
-       (void *)&bleprox_puart_cfg, (void *)&bleprox_gpio_cfg, bleprox_Create);
+    proximity_config_defaults();
+
+    bleapp_set_cfg((UINT8 *)proximity_db_data, sizeof(proximity_db_data), (void *)&proximity_cfg,
+       (void *)&bleprox_puart_cfg, (void *)&bleprox_gpio_cfg, proximity_create);
 
     ble_trace0("proximity_create\n");
 
@@ -0,0 +1,436 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+*
+* LE Proximity application definitions shared between the application modules
+*
+*/
+#ifndef _PROXIMITY_H_
+#define _PROXIMITY_H_
+
+//////////////////////////////////////////////////////////////////////////////
+//                      GATT database handles
+//////////////////////////////////////////////////////////////////////////////
+#define HANDLE_PROX_SERVICE_CHANGED_VALUE           0x0003
+#define HANDLE_PROX_SERVICE_CHANGED_CFG_DESC        0x0004
+#define HANDLE_PROX_LINK_LOSS_ALERT_LEVEL           0x002a
+#define HANDLE_PROX_IMMEDIATE_ALERT_LEVEL           0x002d
+#define HANDLE_PROX_BATTERY_LEVEL                   0x0033
+#define HANDLE_PROX_BATTERY_POWER_STATE             0x0042
+#define HANDLE_PROX_BATTERY_SERVICE_REQUIRED        0x0045
+#define HANDLE_PROX_BATTERY_LEVEL_STATE             0x004b
+#define HANDLE_PROX_BATTERY_LEVEL_STATE_SCCD        0x004d
+
+#define HANDLE_PROX_OTA_SERVICE                     0x0060
+#define HANDLE_PROX_OTA_CHAR_CONTROL_POINT          0x0061
+#define HANDLE_PROX_OTA_CONTROL_POINT_VALUE         0x0062
+#define HANDLE_PROX_OTA_CONTROL_POINT_CFG_DESC      0x0063
+#define HANDLE_PROX_OTA_CHAR_DATA                   0x0064
+#define HANDLE_PROX_OTA_DATA_VALUE                  0x0065
+#define HANDLE_PROX_OTA_LAST                        HANDLE_PROX_OTA_DATA_VALUE
+
+#define HANDLE_PROX_DIAG_SERVICE                    0x0070
+#define HANDLE_PROX_DIAG_CHAR_METRICS               0x0071
+#define HANDLE_PROX_DIAG_METRICS_VALUE              0x0072
+#define HANDLE_PROX_DIAG_METRICS_CFG_DESC           0x0073
+#define HANDLE_PROX_DIAG_CHAR_MEMORY                0x0074
+#define HANDLE_PROX_DIAG_MEMORY_VALUE               0x0075
+#define HANDLE_PROX_DIAG_MEMORY_CFG_DESC            0x0076
+#define HANDLE_PROX_DIAG_CHAR_LINK                  0x0077
+#define HANDLE_PROX_DIAG_LINK_VALUE                 0x0078
+#define HANDLE_PROX_DIAG_CHAR_HANDLE_MAP_ID         0x0079
+#define HANDLE_PROX_DIAG_HANDLE_MAP_ID_VALUE        0x007a
+#define HANDLE_PROX_DIAG_LAST                       HANDLE_PROX_DIAG_HANDLE_MAP_ID_VALUE
+
+#define HANDLE_PROX_SIGNED_ALERT_SERVICE            0x0080
+#define HANDLE_PROX_SIGNED_ALERT_CHAR_KEY           0x0081
+#define HANDLE_PROX_SIGNED_ALERT_KEY_VALUE          0x0082
+#define HANDLE_PROX_SIGNED_ALERT_CHAR_ALERT         0x0083
+#define HANDLE_PROX_SIGNED_ALERT_VALUE              0x0084
+#define HANDLE_PROX_SIGNED_ALERT_LAST               HANDLE_PROX_SIGNED_ALERT_VALUE
+
+#define HANDLE_PROX_CONFIG_SERVICE                  0x0090
+#define HANDLE_PROX_CONFIG_CHAR_CONTROL_POINT       0x0091
+#define HANDLE_PROX_CONFIG_CONTROL_POINT_VALUE      0x0092
+#define HANDLE_PROX_CONFIG_CHAR_VALUE               0x0093
+#define HANDLE_PROX_CONFIG_VALUE                    0x0094
+#define HANDLE_PROX_CONFIG_LAST                     HANDLE_PROX_CONFIG_VALUE
+
+// Vendor specific OTA service 9e5d1e47-5c13-43a0-8635-82ad38a1386f
+#define UUID_PROX_OTA_SERVICE           0x6f, 0x38, 0xa1, 0x38, 0xad, 0x82, 0x35, 0x86, 0xa0, 0x43, 0x13, 0x5c, 0x47, 0x1e, 0x5d, 0x9e
+// OTA control point a3dd50bf-f7a7-4e99-838e-570a086c661b
+#define UUID_PROX_OTA_CONTROL_POINT     0x1b, 0x66, 0x6c, 0x08, 0x0a, 0x57, 0x8e, 0x83, 0x99, 0x4e, 0xa7, 0xf7, 0xbf, 0x50, 0xdd, 0xa3
+// OTA data a2e86c7a-d961-4091-b74f-2409e72efe26
+#define UUID_PROX_OTA_DATA              0x26, 0xfe, 0x2e, 0xe7, 0x09, 0x24, 0x4f, 0xb7, 0x91, 0x40, 0x61, 0xd9, 0x7a, 0x6c, 0xe8, 0xa2
+
+// Vendor specific diagnostics service 5e9bd1f0-6ac4-4f3a-9b8e-0d2c91a7e410
+#define UUID_PROX_DIAG_SERVICE          0x10, 0xe4, 0xa7, 0x91, 0x2c, 0x0d, 0x8e, 0x9b, 0x3a, 0x4f, 0xc4, 0x6a, 0xf0, 0xd1, 0x9b, 0x5e
+// Metrics blob 5e9bd1f1-6ac4-4f3a-9b8e-0d2c91a7e410
+#define UUID_PROX_DIAG_METRICS          0x10, 0xe4, 0xa7, 0x91, 0x2c, 0x0d, 0x8e, 0x9b, 0x3a, 0x4f, 0xc4, 0x6a, 0xf1, 0xd1, 0x9b, 0x5e
+// Stack and pool high water marks 5e9bd1f2-6ac4-4f3a-9b8e-0d2c91a7e410
+#define UUID_PROX_DIAG_MEMORY           0x10, 0xe4, 0xa7, 0x91, 0x2c, 0x0d, 0x8e, 0x9b, 0x3a, 0x4f, 0xc4, 0x6a, 0xf2, 0xd1, 0x9b, 0x5e
+// Link statistics 5e9bd1f3-6ac4-4f3a-9b8e-0d2c91a7e410
+#define UUID_PROX_DIAG_LINK             0x10, 0xe4, 0xa7, 0x91, 0x2c, 0x0d, 0x8e, 0x9b, 0x3a, 0x4f, 0xc4, 0x6a, 0xf3, 0xd1, 0x9b, 0x5e
+// Handle map id 5e9bd1f4-6ac4-4f3a-9b8e-0d2c91a7e410
+#define UUID_PROX_DIAG_HANDLE_MAP_ID    0x10, 0xe4, 0xa7, 0x91, 0x2c, 0x0d, 0x8e, 0x9b, 0x3a, 0x4f, 0xc4, 0x6a, 0xf4, 0xd1, 0x9b, 0x5e
+
+// Vendor specific signed alert service 7c2a4e10-93b5-4d18-a6f2-3e81c05b9d27
+#define UUID_PROX_SIGNED_ALERT_SERVICE  0x27, 0x9d, 0x5b, 0xc0, 0x81, 0x3e, 0xf2, 0xa6, 0x18, 0x4d, 0xb5, 0x93, 0x10, 0x4e, 0x2a, 0x7c
+// Signing key 7c2a4e11-93b5-4d18-a6f2-3e81c05b9d27
+#define UUID_PROX_SIGNED_ALERT_KEY      0x27, 0x9d, 0x5b, 0xc0, 0x81, 0x3e, 0xf2, 0xa6, 0x18, 0x4d, 0xb5, 0x93, 0x11, 0x4e, 0x2a, 0x7c
+// Signed alert level 7c2a4e12-93b5-4d18-a6f2-3e81c05b9d27
+#define UUID_PROX_SIGNED_ALERT_LEVEL    0x27, 0x9d, 0x5b, 0xc0, 0x81, 0x3e, 0xf2, 0xa6, 0x18, 0x4d, 0xb5, 0x93, 0x12, 0x4e, 0x2a, 0x7c
+
+// Vendor specific configuration service 3b8f6d20-1c47-4e95-b0a3-8d52e7f4c619
+#define UUID_PROX_CONFIG_SERVICE        0x19, 0xc6, 0xf4, 0xe7, 0x52, 0x8d, 0xa3, 0xb0, 0x95, 0x4e, 0x47, 0x1c, 0x20, 0x6d, 0x8f, 0x3b
+// Configuration control point 3b8f6d21-1c47-4e95-b0a3-8d52e7f4c619
+#define UUID_PROX_CONFIG_CONTROL_POINT  0x19, 0xc6, 0xf4, 0xe7, 0x52, 0x8d, 0xa3, 0xb0, 0x95, 0x4e, 0x47, 0x1c, 0x21, 0x6d, 0x8f, 0x3b
+// Configuration value 3b8f6d22-1c47-4e95-b0a3-8d52e7f4c619
+#define UUID_PROX_CONFIG_VALUE          0x19, 0xc6, 0xf4, 0xe7, 0x52, 0x8d, 0xa3, 0xb0, 0x95, 0x4e, 0x47, 0x1c, 0x22, 0x6d, 0x8f, 0x3b
+
+// OTA data packet is a 2 byte little endian sequence number followed by the payload.
+// Every packet except the last one carries exactly PROXIMITY_OTA_PAYLOAD_SIZE bytes so
+// that the image offset can be derived from the sequence number.
+#define PROXIMITY_OTA_PAYLOAD_SIZE                  16
+#define PROXIMITY_OTA_DATA_PACKET_SIZE              (2 + PROXIMITY_OTA_PAYLOAD_SIZE)
+
+// Battery Level State: level (1), power state (1), namespace (1), description (2)
+#define PROXIMITY_BATTERY_LEVEL_STATE_SIZE          5
+
+// Broadcast bit of the server characteristic configuration descriptor
+#define PROXIMITY_SCCD_BROADCAST                    0x01
+
+// NVRAM ids used by the application
+#define PROXIMITY_VS_ID_OTA_RESUME                  0x10
+#define PROXIMITY_VS_ID_SIGNING_KEYS                0x11
+#define PROXIMITY_VS_ID_SERVICE_CHANGED             0x12
+#define PROXIMITY_VS_ID_SHADOW                      0x13
+#define PROXIMITY_VS_ID_CONFIG                      0x14
+
+// Signed alert: level (1), sign counter (4), MAC (8)
+#define PROXIMITY_SIGNED_ALERT_SIZE                 13
+
+//////////////////////////////////////////////////////////////////////////////
+//                      event queue
+//////////////////////////////////////////////////////////////////////////////
+enum
+{
+    PROXIMITY_EVENT_CONNECTION_UP,
+    PROXIMITY_EVENT_CONNECTION_DOWN,
+    PROXIMITY_EVENT_ENCRYPTION_CHANGED,     // param is TRUE if the peer is bonded
+    PROXIMITY_EVENT_BOND_RESULT,            // param is native clock before the ROM handler
+    PROXIMITY_EVENT_TIMEOUT,                // param is the number of one second ticks
+    PROXIMITY_EVENT_MAX
+};
+
+typedef struct
+{
+    UINT8   type;
+    UINT32  param;
+    UINT32  clk;                            // native clock when posted
+} PROXIMITY_EVENT;
+
+typedef void (*PROXIMITY_EVENT_HANDLER)(PROXIMITY_EVENT *p_event);
+
+extern const PROXIMITY_EVENT_HANDLER proximity_event_handlers[PROXIMITY_EVENT_MAX];
+
+//////////////////////////////////////////////////////////////////////////////
+//                      sleep governor
+//////////////////////////////////////////////////////////////////////////////
+enum
+{
+    PROXIMITY_SLEEP_PAUSE,
+    PROXIMITY_SLEEP_SLEEP,
+    PROXIMITY_SLEEP_DEEP_SLEEP,
+    PROXIMITY_SLEEP_MAX
+};
+
+//////////////////////////////////////////////////////////////////////////////
+//                      application timers
+//////////////////////////////////////////////////////////////////////////////
+// Timer of the one second timer service, allocated by the owner
+typedef struct PROXIMITY_TIMER
+{
+    struct PROXIMITY_TIMER *next;
+    UINT32  deadline;                       // tick the timer is due
+    UINT16  period;                         // seconds, 0 for one shot
+    UINT16  slack;                          // seconds the timer may run late
+    void    (*cb)(void);
+} PROXIMITY_TIMER;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      runtime configuration
+//////////////////////////////////////////////////////////////////////////////
+// Parameters of the configuration service, all values are 16 bits
+enum
+{
+    PROXIMITY_CONFIG_HIGH_ADV_INTERVAL,
+    PROXIMITY_CONFIG_LOW_ADV_INTERVAL,
+    PROXIMITY_CONFIG_HIGH_ADV_DURATION,
+    PROXIMITY_CONFIG_LOW_ADV_DURATION,
+    PROXIMITY_CONFIG_CONN_INTERVAL_MIN,
+    PROXIMITY_CONFIG_CONN_INTERVAL_MAX,
+    PROXIMITY_CONFIG_CONN_LATENCY,
+    PROXIMITY_CONFIG_CONN_TIMEOUT,
+    PROXIMITY_CONFIG_ALERT_INTERVAL,
+    PROXIMITY_CONFIG_HIGH_ALERT_NUM,
+    PROXIMITY_CONFIG_MILD_ALERT_NUM,
+    PROXIMITY_CONFIG_BUZ_ON_MS,
+    PROXIMITY_CONFIG_MAX
+};
+
+// Configuration value: version (2) followed by all parameters
+#define PROXIMITY_CONFIG_VALUE_SIZE                 (2 + 2 * PROXIMITY_CONFIG_MAX)
+
+extern BLE_PROFILE_CFG proximity_cfg;
+extern const BLE_PROFILE_GPIO_CFG bleprox_gpio_cfg;
+
+// Link encryption succeeded, cleared when the link goes down
+extern BOOL32 proximity_link_encrypted;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      profiling probes
+//////////////////////////////////////////////////////////////////////////////
+// Application callbacks measured with the Cortex-M3 cycle counter
+enum
+{
+    PROXIMITY_PROBE_CONNECTION_UP,
+    PROXIMITY_PROBE_CONNECTION_DOWN,
+    PROXIMITY_PROBE_ADV_STOP,
+    PROXIMITY_PROBE_TIMEOUT,
+    PROXIMITY_PROBE_FINE_TIMEOUT,
+    PROXIMITY_PROBE_WRITE,
+    PROXIMITY_PROBE_BOND_RESULT,
+    PROXIMITY_PROBE_ENCRYPTION_CHANGED,
+    PROXIMITY_PROBE_GPIO_BUTTON,            // interrupt handlers
+    PROXIMITY_PROBE_GPIO_BATTERY,
+    PROXIMITY_PROBE_MAX
+};
+
+// Histogram buckets of each probe
+#define PROXIMITY_PROBE_BUCKETS                     16
+
+#define PROXIMITY_DWT_CTRL                          (*(volatile UINT32 *)0xE0001000)
+#define PROXIMITY_DWT_CYCCNT                        (*(volatile UINT32 *)0xE0001004)
+#define PROXIMITY_SCB_DEMCR                         (*(volatile UINT32 *)0xE000EDFC)
+
+// Native Bluetooth clock tick is 312.5 usec, connection interval unit 1.25 msec
+#define PROXIMITY_NATIVE_CLKS_PER_SEC               3200
+#define PROXIMITY_NATIVE_CLKS_PER_CONN_UNIT         4
+#define PROXIMITY_NATIVE_CLKS_TO_USEC(clks)         (((clks) * 625) / 2)
+#define PROXIMITY_NATIVE_CLKS_TO_MSEC(clks)         (((clks) * 5) / 16)
+
+#define PROXIMITY_PROBE_START(start)                UINT32 start = PROXIMITY_DWT_CYCCNT
+#define PROXIMITY_PROBE_STOP(id, start)             proximity_probe_record(id, PROXIMITY_DWT_CYCCNT - (start))
+
+//////////////////////////////////////////////////////////////////////////////
+//                      memory high water marks
+//////////////////////////////////////////////////////////////////////////////
+// Buffers and queues of the application with peak usage tracking
+enum
+{
+    PROXIMITY_POOL_NOTIFICATION,            // notifications queued in one fine timer tick
+    PROXIMITY_POOL_EVENT,                   // events waiting for the dispatcher
+    PROXIMITY_POOL_GPIO,                    // GPIO interrupts waiting for deferred work
+    PROXIMITY_POOL_MAX
+};
+
+// Size of the memory characteristic value
+#define PROXIMITY_DIAG_MEMORY_SIZE                  (6 + PROXIMITY_POOL_MAX)
+
+extern UINT32 proximity_diag_min_sp;
+
+// Record the stack pointer if it is the deepest seen so far
+#define PROXIMITY_STACK_SAMPLE()                                                \
+{                                                                               \
+    UINT32 sp;                                                                  \
+    __asm volatile ("mov %0, sp" : "=r" (sp));                                  \
+    if (sp < proximity_diag_min_sp)                                             \
+        proximity_diag_min_sp = sp;                                             \
+}
+
+// Size of the link statistics characteristic value
+#define PROXIMITY_LINK_STATS_SIZE                   16
+
+//////////////////////////////////////////////////////////////////////////////
+//                      metrics blob
+//////////////////////////////////////////////////////////////////////////////
+#define PROXIMITY_METRICS_VERSION                   1
+
+// Type of the TLV records in the metrics blob
+enum
+{
+    PROXIMITY_TLV_PROBE             = 0x01,     // probe id (1), calls (4), min (4), average (4), max (4) cycles
+    PROXIMITY_TLV_PROBE_HISTOGRAM   = 0x02,     // probe id (1), first bucket (1), bucket counts (2 each)
+    PROXIMITY_TLV_MEMORY            = 0x03,     // memory characteristic value
+    PROXIMITY_TLV_LINK              = 0x04,     // link characteristic value
+    PROXIMITY_TLV_BATTERY           = 0x05,     // level (1), power state (1), service required (1)
+    PROXIMITY_TLV_NVRAM             = 0x06,     // writes (4), bytes written (4) since power up
+    PROXIMITY_TLV_PAIRING           = 0x07,     // per pairing phase: count, last, min, max msec (2 each)
+    PROXIMITY_TLV_TIMER             = 0x08,     // ticks (4), ticks that ran timers (4), timers run (4)
+    PROXIMITY_TLV_EVENT             = 0x09,     // dropped (4), per event type: count, average and max latency usec, max run cycles (4 each)
+    PROXIMITY_TLV_SLEEP             = 0x0a,     // per sleep state: entries (4), residency msec (4)
+    PROXIMITY_TLV_GPIO              = 0x0b,     // interrupts, overflows, max handler cycles, max latency usec, button presses (4 each)
+    PROXIMITY_TLV_IAS               = 0x0c,     // Immediate Alert writes, passed to the ROM, collapsed (4 each)
+};
+
+// Value size of the records
+#define PROXIMITY_TLV_PROBE_SIZE                    17
+#define PROXIMITY_TLV_PROBE_HISTOGRAM_SIZE          (2 + 2 * PROXIMITY_PROBE_BUCKETS)
+#define PROXIMITY_TLV_MEMORY_SIZE                   PROXIMITY_DIAG_MEMORY_SIZE
+#define PROXIMITY_TLV_LINK_SIZE                     PROXIMITY_LINK_STATS_SIZE
+#define PROXIMITY_TLV_BATTERY_SIZE                  3
+#define PROXIMITY_TLV_NVRAM_SIZE                    8
+#define PROXIMITY_TLV_PAIRING_SIZE                  (4 * 8)
+#define PROXIMITY_TLV_TIMER_SIZE                    12
+#define PROXIMITY_TLV_EVENT_SIZE                    (4 + PROXIMITY_EVENT_MAX * 16)
+#define PROXIMITY_TLV_SLEEP_SIZE                    (PROXIMITY_SLEEP_MAX * 8)
+#define PROXIMITY_TLV_GPIO_SIZE                     20
+#define PROXIMITY_TLV_IAS_SIZE                      12
+
+// Build fails here if the condition does not hold
+#define PROXIMITY_BUILD_ASSERT(name, cond)          typedef char proximity_assert_##name[(cond) ? 1 : -1]
+
+// Generates the part of the blob from offset to offset + size into p
+typedef struct
+{
+    UINT8   *p;
+    UINT16  offset;
+    UINT16  size;
+    UINT16  len;                                // blob bytes generated so far
+    UINT8   *p_value;                           // value of the last record, copied on the next add
+    UINT8   value_len;
+} PROXIMITY_TLV_WRITER;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function prototypes
+//////////////////////////////////////////////////////////////////////////////
+void proximity_probe_init(void);
+void proximity_probe_record(UINT8 id, UINT32 cycles);
+void proximity_probe_reset(void);
+void proximity_probe_trace(void);
+void proximity_probe_add_metrics(PROXIMITY_TLV_WRITER *p_tlv);
+
+void proximity_diag_init(void);
+void proximity_diag_pool_use(UINT8 pool, UINT8 used);
+void proximity_diag_timeout(void);
+void proximity_diag_connection_up(void);
+void proximity_diag_add_metrics(PROXIMITY_TLV_WRITER *p_tlv);
+
+void proximity_link_connection_up(void);
+void proximity_link_connection_down(void);
+BOOL32 proximity_link_is_connected(void);
+void proximity_link_data_rx(void);
+void proximity_link_data_tx(void);
+void proximity_link_timeout(void);
+void proximity_link_add_metrics(PROXIMITY_TLV_WRITER *p_tlv);
+
+void   proximity_metrics_init(void);
+int    proximity_metrics_write_handler(LEGATTDB_ENTRY_HDR *p);
+void   proximity_metrics_fine_timeout(void);
+void   proximity_metrics_connection_down(void);
+UINT8 *proximity_tlv_add(PROXIMITY_TLV_WRITER *p_tlv, UINT8 type, UINT8 len);
+void   proximity_tlv_put32(UINT8 *p, UINT32 value);
+
+void proximity_pairing_connection_up(UINT32 clk);
+void proximity_pairing_encryption_changed(BOOL32 bonded, UINT32 clk);
+void proximity_pairing_bond_result(UINT32 start_clk, UINT32 end_clk);
+void proximity_pairing_add_metrics(PROXIMITY_TLV_WRITER *p_tlv);
+
+void proximity_adv_init(void);
+void proximity_adv_timeout(void);
+void proximity_adv_resume(void);
+void proximity_adv_refresh(void);
+
+BOOL32 proximity_event_post(UINT8 type, UINT32 param);
+BOOL32 proximity_event_pending(void);
+void   proximity_event_fine_timeout(void);
+void   proximity_event_add_metrics(PROXIMITY_TLV_WRITER *p_tlv);
+
+void proximity_timer_start(PROXIMITY_TIMER *p_timer, UINT16 delay, UINT16 period, UINT16 slack, void (*cb)(void));
+void proximity_timer_stop(PROXIMITY_TIMER *p_timer);
+void proximity_timer_timeout(void);
+UINT32 proximity_timer_next_usec(void);
+BOOL32 proximity_timer_armed(void);
+void proximity_timer_add_metrics(PROXIMITY_TLV_WRITER *p_tlv);
+
+int    proximity_ias_write(LEGATTDB_ENTRY_HDR *p);
+void   proximity_ias_alert(UINT8 level);
+BOOL32 proximity_ias_alert_active(void);
+void   proximity_ias_fine_timeout(void);
+void   proximity_ias_connection_down(void);
+void   proximity_ias_add_metrics(PROXIMITY_TLV_WRITER *p_tlv);
+
+void   proximity_gpio_init(void);
+void   proximity_gpio_fine_timeout(void);
+BOOL32 proximity_gpio_wake_configured(void);
+void   proximity_gpio_add_metrics(PROXIMITY_TLV_WRITER *p_tlv);
+
+void proximity_sleep_init(void);
+void proximity_sleep_add_metrics(PROXIMITY_TLV_WRITER *p_tlv);
+
+void proximity_signed_alert_init(void);
+void proximity_signed_alert_connection_up(void);
+void proximity_signed_alert_connection_down(void);
+int  proximity_signed_alert_write_handler(LEGATTDB_ENTRY_HDR *p);
+
+void proximity_service_changed_init(const UINT8 *p_db, UINT16 len);
+void proximity_service_changed_encryption_changed(BOOL32 bonded);
+void proximity_service_changed_bond_result(void);
+void proximity_service_changed_connection_down(void);
+int  proximity_service_changed_write_handler(LEGATTDB_ENTRY_HDR *p);
+
+void proximity_shadow_init(void);
+void proximity_shadow_write(UINT16 handle, UINT8 *p, int len);
+void proximity_shadow_flush(void);
+
+void   proximity_config_defaults(void);
+void   proximity_config_init(void);
+void   proximity_config_connection_up(void);
+void   proximity_config_connection_down(void);
+int    proximity_config_write_handler(LEGATTDB_ENTRY_HDR *p);
+UINT16 proximity_config_get(UINT8 id);
+
+BOOL32 proximity_send_notification(UINT16 cfg_handle, UINT16 handle, UINT8 *p, UINT8 len);
+UINT32 proximity_crc32(UINT32 crc, UINT8 *p, UINT16 len);
+UINT8  proximity_write_nvram(UINT8 vs_id, UINT8 len, UINT8 *p);
+void   proximity_nvram_add_metrics(PROXIMITY_TLV_WRITER *p_tlv);
+
+#ifdef OTA_FW_UPGRADE
+void proximity_ota_init(void);
+int  proximity_ota_write_handler(LEGATTDB_ENTRY_HDR *p);
+void proximity_ota_connection_down(void);
+#endif
+
+#endif // _PROXIMITY_H_
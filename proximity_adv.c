@@ -0,0 +1,180 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity scan response service data
+*
+* The advertising data is the one the ROM proximity application sets up and
+* is not changed here.  Values a scanner can use without connecting are sent
+* as service data in the scan response, which a scanner receives when it scans
+* actively
+*
+*  Link Loss service data : alert level (1), advertising interval (2)
+*  Battery service data   : Battery Level State (5), only when broadcast
+*
+* Link Loss service data lets a gateway treat a fob that stopped advertising
+* like a lost link: the advertising interval (0.625 msec units) is the longest
+* gap between advertisements in the low duty cycle, and the alert level is the
+* one the owner configured in the Link Loss service.
+*
+* When a client sets the broadcast bit in the server characteristic configuration
+* descriptor of the Battery Level State, the scan response also carries the
+* 5 byte Battery Level State value as the Battery Service specifies.  Service
+* data is refreshed from the GATT database when a value or the broadcast
+* setting changes.
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+UINT8 proximity_adv_battery_state[PROXIMITY_BATTERY_LEVEL_STATE_SIZE];
+UINT8 proximity_adv_broadcast;
+UINT8 proximity_adv_link_loss_level;
+PROXIMITY_TIMER proximity_adv_timer;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+static UINT8 proximity_adv_read_value(UINT16 handle)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+
+    bleprofile_ReadHandle(handle, &db_pdu);
+    return db_pdu.pdu[0];
+}
+
+static void proximity_adv_set_scan_response(void)
+{
+    BLE_ADV_FIELD scr[2];
+
+    scr[0].len     = 2 + 3 + 1;
+    scr[0].val     = ADV_SERVICE_DATA;
+    scr[0].data[0] = (UINT8)UUID_SERVICE_LINK_LOSS;
+    scr[0].data[1] = (UINT8)(UUID_SERVICE_LINK_LOSS >> 8);
+    scr[0].data[2] = proximity_adv_link_loss_level;
+    scr[0].data[3] = (UINT8)bleprofile_p_cfg->low_undirect_adv_interval;
+    scr[0].data[4] = (UINT8)(bleprofile_p_cfg->low_undirect_adv_interval >> 8);
+
+    scr[1].len     = 2 + PROXIMITY_BATTERY_LEVEL_STATE_SIZE + 1;
+    scr[1].val     = ADV_SERVICE_DATA;
+    scr[1].data[0] = (UINT8)UUID_SERVICE_BATTERY;
+    scr[1].data[1] = (UINT8)(UUID_SERVICE_BATTERY >> 8);
+    memcpy(&scr[1].data[2], proximity_adv_battery_state, PROXIMITY_BATTERY_LEVEL_STATE_SIZE);
+
+    bleprofile_GenerateScanRspData(scr, proximity_adv_broadcast ? 2 : 1);
+}
+
+// Read battery values from the database, returns TRUE if the scan response
+// needs to be updated.
+static BOOL32 proximity_adv_read_battery(void)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+    UINT8  level     = proximity_adv_read_value(HANDLE_PROX_BATTERY_LEVEL);
+    UINT8  broadcast = proximity_adv_read_value(HANDLE_PROX_BATTERY_LEVEL_STATE_SCCD) & PROXIMITY_SCCD_BROADCAST;
+    BOOL32 changed   = (broadcast != proximity_adv_broadcast);
+
+    // Level in the Battery Level State follows the Battery Level characteristic
+    bleprofile_ReadHandle(HANDLE_PROX_BATTERY_LEVEL_STATE, &db_pdu);
+    if (db_pdu.pdu[0] != level)
+    {
+        db_pdu.pdu[0] = level;
+        bleprofile_WriteHandle(HANDLE_PROX_BATTERY_LEVEL_STATE, &db_pdu);
+    }
+
+    if (memcmp(proximity_adv_battery_state, db_pdu.pdu, PROXIMITY_BATTERY_LEVEL_STATE_SIZE) != 0)
+    {
+        memcpy(proximity_adv_battery_state, db_pdu.pdu, PROXIMITY_BATTERY_LEVEL_STATE_SIZE);
+        changed = broadcast || changed;
+    }
+    proximity_adv_broadcast = broadcast;
+    return changed;
+}
+
+// Read Link Loss alert level, returns TRUE if it changed
+static BOOL32 proximity_adv_read_link_loss(void)
+{
+    UINT8 level = proximity_adv_read_value(HANDLE_PROX_LINK_LOSS_ALERT_LEVEL);
+
+    if (level == proximity_adv_link_loss_level)
+        return FALSE;
+
+    proximity_adv_link_loss_level = level;
+    return TRUE;
+}
+
+// Add service data to the scan response, the ROM application has set up the
+// advertising data
+void proximity_adv_init(void)
+{
+    proximity_adv_read_battery();
+    proximity_adv_read_link_loss();
+
+    proximity_adv_set_scan_response();
+
+    proximity_timer_start(&proximity_adv_timer, 1, 1, 0, proximity_adv_timeout);
+}
+
+// Refresh service data if the advertised values changed, runs every second
+// while advertising or connected
+void proximity_adv_timeout(void)
+{
+    BOOL32 changed = proximity_adv_read_battery();
+
+    if (proximity_adv_read_link_loss() || changed)
+    {
+        proximity_adv_set_scan_response();
+    }
+
+    if (!proximity_link_is_connected() && (bleprofile_GetDiscoverable() == NO_DISCOVERABLE))
+        proximity_timer_stop(&proximity_adv_timer);
+}
+
+// Advertising parameters changed
+void proximity_adv_refresh(void)
+{
+    proximity_adv_set_scan_response();
+}
+
+// Advertising or a connection may have started
+void proximity_adv_resume(void)
+{
+    proximity_timer_start(&proximity_adv_timer, 1, 1, 0, proximity_adv_timeout);
+}
@@ -0,0 +1,326 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity runtime configuration
+*
+* Advertising, connection and alert parameters can be tuned by a client over
+* the vendor specific configuration service without a new firmware build.  The
+* client writes the control point, which is only accepted on an encrypted link
+* to a bonded peer
+*
+*  STAGE   (0x01), then one or more of parameter id (1), value (2)
+*  COMMIT  (0x02), version (2)
+*  DISCARD (0x03)
+*
+* Staged values are not used until the commit and are discarded when the link
+* goes down.  A STAGE write with an invalid parameter id stages nothing.  The
+* commit carries the version
+* the configuration will have, which must be the current version plus one, so
+* that a client working from an old read can not overwrite a newer change.
+* The staged values are merged with the current ones and the whole set is
+* validated before anything is applied, then saved with one NVRAM write.  The
+* configuration value characteristic reads back the version and all parameters.
+*
+* The stack reads the advertising parameters from the profile configuration,
+* which is a RAM copy of bleprox_cfg for this purpose.  New advertising
+* parameters are used from the next advertisement start, the advertising
+* interval sent in the Link Loss service data is updated right away.  New
+* connection parameters are requested from the central right away.
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+#define PROXIMITY_CONFIG_CMD_STAGE              0x01
+#define PROXIMITY_CONFIG_CMD_COMMIT             0x02
+#define PROXIMITY_CONFIG_CMD_DISCARD            0x03
+
+#define PROXIMITY_CONFIG_ERR_INVALID_CMD        0x81
+#define PROXIMITY_CONFIG_ERR_VERSION            0x82
+#define PROXIMITY_CONFIG_ERR_OUT_OF_RANGE       0x83
+#define PROXIMITY_CONFIG_ERR_NOTHING_STAGED     0x84
+
+typedef struct
+{
+    UINT16  version;
+    UINT16  param[PROXIMITY_CONFIG_MAX];
+} PROXIMITY_CONFIG;
+
+typedef struct
+{
+    UINT16  min;
+    UINT16  max;
+} PROXIMITY_CONFIG_RANGE;
+
+static const PROXIMITY_CONFIG_RANGE proximity_config_range[PROXIMITY_CONFIG_MAX] =
+{
+    { 0x0020, 0x4000 },     // HIGH_ADV_INTERVAL, slots of 0.625 msec
+    { 0x0020, 0x4000 },     // LOW_ADV_INTERVAL
+    { 0,      3600 },       // HIGH_ADV_DURATION, seconds
+    { 0,      3600 },       // LOW_ADV_DURATION
+    { 0,      3200 },       // CONN_INTERVAL_MIN, 1.25 msec, 0 leaves it to the central
+    { 0,      3200 },       // CONN_INTERVAL_MAX
+    { 0,      499 },        // CONN_LATENCY
+    { 0,      3200 },       // CONN_TIMEOUT, 10 msec
+    { 0,      255 },        // ALERT_INTERVAL
+    { 0,      255 },        // HIGH_ALERT_NUM
+    { 0,      255 },        // MILD_ALERT_NUM
+    { 0,      2000 },       // BUZ_ON_MS
+};
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+// Profile configuration passed to the stack
+BLE_PROFILE_CFG proximity_cfg;
+
+PROXIMITY_CONFIG proximity_config;
+PROXIMITY_CONFIG proximity_config_staged;
+UINT16 proximity_config_staged_mask;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+UINT16 proximity_config_get(UINT8 id)
+{
+    return proximity_config.param[id];
+}
+
+// Validate parameters that depend on each other
+static BOOL32 proximity_config_validate(PROXIMITY_CONFIG *p_config)
+{
+    UINT16 *param = p_config->param;
+    UINT8  i;
+
+    for (i = 0; i < PROXIMITY_CONFIG_MAX; i++)
+    {
+        if ((param[i] < proximity_config_range[i].min) || (param[i] > proximity_config_range[i].max))
+            return FALSE;
+    }
+
+    if (param[PROXIMITY_CONFIG_HIGH_ADV_INTERVAL] > param[PROXIMITY_CONFIG_LOW_ADV_INTERVAL])
+        return FALSE;
+
+    if (param[PROXIMITY_CONFIG_CONN_INTERVAL_MIN] != 0)
+    {
+        if ((param[PROXIMITY_CONFIG_CONN_INTERVAL_MIN] < 6) ||
+            (param[PROXIMITY_CONFIG_CONN_INTERVAL_MIN] > param[PROXIMITY_CONFIG_CONN_INTERVAL_MAX]) ||
+            (param[PROXIMITY_CONFIG_CONN_TIMEOUT] < 10))
+            return FALSE;
+
+        // supervision timeout must be longer than two effective connection intervals
+        if ((UINT32)param[PROXIMITY_CONFIG_CONN_TIMEOUT] * 4 <=
+            (UINT32)(1 + param[PROXIMITY_CONFIG_CONN_LATENCY]) * param[PROXIMITY_CONFIG_CONN_INTERVAL_MAX])
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void proximity_config_update_value(void)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+    UINT8 i;
+
+    db_pdu.len = PROXIMITY_CONFIG_VALUE_SIZE;
+    db_pdu.pdu[0] = (UINT8)proximity_config.version;
+    db_pdu.pdu[1] = (UINT8)(proximity_config.version >> 8);
+    for (i = 0; i < PROXIMITY_CONFIG_MAX; i++)
+    {
+        db_pdu.pdu[2 + i * 2]     = (UINT8)proximity_config.param[i];
+        db_pdu.pdu[2 + i * 2 + 1] = (UINT8)(proximity_config.param[i] >> 8);
+    }
+    bleprofile_WriteHandle(HANDLE_PROX_CONFIG_VALUE, &db_pdu);
+}
+
+static void proximity_config_apply(void)
+{
+    UINT16 *param = proximity_config.param;
+
+    proximity_cfg.high_undirect_adv_interval = param[PROXIMITY_CONFIG_HIGH_ADV_INTERVAL];
+    proximity_cfg.low_undirect_adv_interval  = param[PROXIMITY_CONFIG_LOW_ADV_INTERVAL];
+    proximity_cfg.high_undirect_adv_duration = param[PROXIMITY_CONFIG_HIGH_ADV_DURATION];
+    proximity_cfg.low_undirect_adv_duration  = param[PROXIMITY_CONFIG_LOW_ADV_DURATION];
+    proximity_cfg.alert_interval             = param[PROXIMITY_CONFIG_ALERT_INTERVAL];
+    proximity_cfg.high_alert_num             = param[PROXIMITY_CONFIG_HIGH_ALERT_NUM];
+    proximity_cfg.mild_alert_num             = param[PROXIMITY_CONFIG_MILD_ALERT_NUM];
+    proximity_cfg.buz_on_ms                  = param[PROXIMITY_CONFIG_BUZ_ON_MS];
+
+    proximity_config_update_value();
+}
+
+// Request the configured connection parameters, if any
+void proximity_config_connection_up(void)
+{
+    UINT16 *param = proximity_config.param;
+
+    if (param[PROXIMITY_CONFIG_CONN_INTERVAL_MIN] != 0)
+    {
+        bleprofile_SendConnParamUpdateReq(param[PROXIMITY_CONFIG_CONN_INTERVAL_MIN], param[PROXIMITY_CONFIG_CONN_INTERVAL_MAX],
+                                          param[PROXIMITY_CONFIG_CONN_LATENCY], param[PROXIMITY_CONFIG_CONN_TIMEOUT]);
+    }
+}
+
+// Staged values belong to the client that wrote them
+void proximity_config_connection_down(void)
+{
+    proximity_config_staged_mask = 0;
+}
+
+// Copy the build time configuration, called before the stack is configured
+void proximity_config_defaults(void)
+{
+    memcpy(&proximity_cfg, &bleprox_cfg, sizeof(proximity_cfg));
+}
+
+// Load the saved configuration, or take the defaults from the build time one
+void proximity_config_init(void)
+{
+    UINT16 *param = proximity_config.param;
+
+    if ((bleprofile_ReadNVRAM(PROXIMITY_VS_ID_CONFIG, sizeof(proximity_config), (UINT8 *)&proximity_config) == sizeof(proximity_config)) &&
+        proximity_config_validate(&proximity_config))
+    {
+        ble_trace1("config: version:%d\n", proximity_config.version);
+    }
+    else
+    {
+        memset(&proximity_config, 0, sizeof(proximity_config));
+        param[PROXIMITY_CONFIG_HIGH_ADV_INTERVAL] = proximity_cfg.high_undirect_adv_interval;
+        param[PROXIMITY_CONFIG_LOW_ADV_INTERVAL]  = proximity_cfg.low_undirect_adv_interval;
+        param[PROXIMITY_CONFIG_HIGH_ADV_DURATION] = proximity_cfg.high_undirect_adv_duration;
+        param[PROXIMITY_CONFIG_LOW_ADV_DURATION]  = proximity_cfg.low_undirect_adv_duration;
+        param[PROXIMITY_CONFIG_ALERT_INTERVAL]    = proximity_cfg.alert_interval;
+        param[PROXIMITY_CONFIG_HIGH_ALERT_NUM]    = proximity_cfg.high_alert_num;
+        param[PROXIMITY_CONFIG_MILD_ALERT_NUM]    = proximity_cfg.mild_alert_num;
+        param[PROXIMITY_CONFIG_BUZ_ON_MS]         = proximity_cfg.buz_on_ms;
+    }
+    proximity_config_apply();
+}
+
+static int proximity_config_stage(UINT8 *p, int len)
+{
+    int i;
+
+    if ((len == 0) || (len % 3) != 0)
+        return PROXIMITY_CONFIG_ERR_INVALID_CMD;
+
+    for (i = 0; i < len; i += 3)
+    {
+        if (p[i] >= PROXIMITY_CONFIG_MAX)
+            return PROXIMITY_CONFIG_ERR_INVALID_CMD;
+    }
+
+    if (proximity_config_staged_mask == 0)
+    {
+        memcpy(&proximity_config_staged, &proximity_config, sizeof(proximity_config_staged));
+    }
+
+    for (; len > 0; p += 3, len -= 3)
+    {
+        proximity_config_staged.param[p[0]] = p[1] | (p[2] << 8);
+        proximity_config_staged_mask |= 1 << p[0];
+    }
+    return 0;
+}
+
+static int proximity_config_commit(UINT16 version)
+{
+    UINT16 changed = proximity_config_staged_mask;
+
+    if (changed == 0)
+        return PROXIMITY_CONFIG_ERR_NOTHING_STAGED;
+
+    if (version != (UINT16)(proximity_config.version + 1))
+        return PROXIMITY_CONFIG_ERR_VERSION;
+
+    // Staged values are kept so that the client can fix the rejected one
+    if (!proximity_config_validate(&proximity_config_staged))
+        return PROXIMITY_CONFIG_ERR_OUT_OF_RANGE;
+
+    proximity_config_staged.version = version;
+    memcpy(&proximity_config, &proximity_config_staged, sizeof(proximity_config));
+    proximity_config_staged_mask = 0;
+
+    proximity_write_nvram(PROXIMITY_VS_ID_CONFIG, sizeof(proximity_config), (UINT8 *)&proximity_config);
+    proximity_config_apply();
+
+    if (changed & ((1 << PROXIMITY_CONFIG_CONN_INTERVAL_MIN) | (1 << PROXIMITY_CONFIG_CONN_INTERVAL_MAX) |
+                   (1 << PROXIMITY_CONFIG_CONN_LATENCY) | (1 << PROXIMITY_CONFIG_CONN_TIMEOUT)))
+    {
+        proximity_config_connection_up();
+    }
+
+    if (changed & (1 << PROXIMITY_CONFIG_LOW_ADV_INTERVAL))
+    {
+        proximity_adv_refresh();
+    }
+
+    ble_trace2("config: version:%d changed:%04x\n", version, changed);
+    return 0;
+}
+
+// Process write to the configuration service
+int proximity_config_write_handler(LEGATTDB_ENTRY_HDR *p)
+{
+    UINT16  handle   = legattdb_getHandle(p);
+    int     len      = legattdb_getAttrValueLen(p);
+    UINT8   *attrPtr = legattdb_getAttrValue(p);
+
+    if ((handle != HANDLE_PROX_CONFIG_CONTROL_POINT_VALUE) || (len < 1))
+        return PROXIMITY_CONFIG_ERR_INVALID_CMD;
+
+    switch (attrPtr[0])
+    {
+    case PROXIMITY_CONFIG_CMD_STAGE:
+        return proximity_config_stage(&attrPtr[1], len - 1);
+
+    case PROXIMITY_CONFIG_CMD_COMMIT:
+        if (len != 3)
+            return PROXIMITY_CONFIG_ERR_INVALID_CMD;
+        return proximity_config_commit(attrPtr[1] | (attrPtr[2] << 8));
+
+    case PROXIMITY_CONFIG_CMD_DISCARD:
+        proximity_config_staged_mask = 0;
+        return 0;
+    }
+    return PROXIMITY_CONFIG_ERR_INVALID_CMD;
+}
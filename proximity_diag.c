@@ -0,0 +1,212 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity stack and RAM high water marks
+*
+* On the 20736 the application callbacks run on the thread of the embedded
+* stack, so there is one stack to watch.  When the application is created the
+* part of the stack below the current frame is painted with a known pattern and
+* then scanned from the bottom up periodically while connected, the first
+* modified word marks the deepest use.  The paint window runs from the base of
+* the thread stack, as recorded in the ThreadX thread control block, up to
+* PROXIMITY_DIAG_STACK_PAINT_GUARD bytes below the current frame, and is limited
+* to PROXIMITY_DIAG_STACK_PAINT_SIZE bytes.  Every profiled callback also
+* samples the stack pointer, which catches use below the painted window as
+* well.
+*
+* Application pools report their use through proximity_diag_pool_use() and only
+* the peak is kept.
+*
+* Results are available in the memory characteristic of the diagnostics service
+* and in the metrics blob
+*  - stack paint window in bytes (2)
+*  - stack used below the create frame, from the paint scan (2)
+*  - stack used below the create frame, deepest callback sample (2)
+*  - peak use of every pool (1 each)
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "string.h"
+#include "tx_api.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+// Most bytes of stack painted below the frame of the create function.  Words right
+// below the current frame are skipped to leave room for the painting code itself.
+#define PROXIMITY_DIAG_STACK_PAINT_SIZE     512
+#define PROXIMITY_DIAG_STACK_PAINT_GUARD    64
+#define PROXIMITY_DIAG_STACK_PATTERN        0xa5a5a5a5
+
+// Stack is scanned and the memory characteristic updated every few seconds,
+// exact time does not matter so the scan can run with other timers
+#define PROXIMITY_DIAG_SCAN_INTERVAL        10
+#define PROXIMITY_DIAG_SCAN_SLACK           5
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+UINT32 proximity_diag_min_sp = 0xffffffff;
+
+UINT32 proximity_diag_boot_sp;
+UINT32 *proximity_diag_paint_start;         // lowest painted word
+UINT16 proximity_diag_paint_words;
+UINT16 proximity_diag_paint_size;           // bytes from the lowest painted word to the create frame
+UINT16 proximity_diag_stack_used;           // result of the last paint scan
+UINT8  proximity_diag_pool_peak[PROXIMITY_POOL_MAX];
+PROXIMITY_TIMER proximity_diag_timer;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+// Paint the unused part of the stack below the current frame
+void proximity_diag_init(void)
+{
+    TX_THREAD *thread = tx_thread_identify();
+    UINT32 i;
+    UINT32 sp;
+    UINT32 start;
+    UINT32 end;
+
+    __asm volatile ("mov %0, sp" : "=r" (sp));
+
+    proximity_diag_boot_sp     = sp;
+    proximity_diag_min_sp      = sp;
+    proximity_diag_paint_words = 0;
+    proximity_diag_paint_size  = 0;
+
+    // Stack of the thread is tx_thread_stack_start up to tx_thread_stack_end
+    start = (sp - PROXIMITY_DIAG_STACK_PAINT_SIZE) & ~3;
+    end   = (sp - PROXIMITY_DIAG_STACK_PAINT_GUARD) & ~3;
+    if ((thread != NULL) &&
+        (sp > (UINT32)thread->tx_thread_stack_start) && (sp <= (UINT32)thread->tx_thread_stack_end))
+    {
+        if (start < (UINT32)thread->tx_thread_stack_start)
+            start = ((UINT32)thread->tx_thread_stack_start + 3) & ~3;
+        if (end > start)
+        {
+            proximity_diag_paint_words = (UINT16)((end - start) / 4);
+            proximity_diag_paint_size  = (UINT16)(sp - start);
+        }
+    }
+    proximity_diag_paint_start = (UINT32 *)start;
+
+    for (i = 0; i < proximity_diag_paint_words; i++)
+    {
+        proximity_diag_paint_start[i] = PROXIMITY_DIAG_STACK_PATTERN;
+    }
+
+    memset(proximity_diag_pool_peak, 0, sizeof(proximity_diag_pool_peak));
+
+    proximity_timer_start(&proximity_diag_timer, PROXIMITY_DIAG_SCAN_INTERVAL, PROXIMITY_DIAG_SCAN_INTERVAL,
+                          PROXIMITY_DIAG_SCAN_SLACK, proximity_diag_timeout);
+}
+
+void proximity_diag_pool_use(UINT8 pool, UINT8 used)
+{
+    if (used > proximity_diag_pool_peak[pool])
+    {
+        proximity_diag_pool_peak[pool] = used;
+    }
+}
+
+// Count untouched words from the bottom of the painted window
+static void proximity_diag_scan_stack(void)
+{
+    UINT16 i;
+
+    for (i = 0; i < proximity_diag_paint_words; i++)
+    {
+        if (proximity_diag_paint_start[i] != PROXIMITY_DIAG_STACK_PATTERN)
+            break;
+    }
+    proximity_diag_stack_used = (proximity_diag_paint_words != 0) ? proximity_diag_paint_size - i * 4 : 0;
+}
+
+static void proximity_diag_memory_value(UINT8 *p)
+{
+    UINT16 sampled = (UINT16)(proximity_diag_boot_sp - proximity_diag_min_sp);
+
+    p[0] = (UINT8)proximity_diag_paint_size;
+    p[1] = (UINT8)(proximity_diag_paint_size >> 8);
+    p[2] = (UINT8)proximity_diag_stack_used;
+    p[3] = (UINT8)(proximity_diag_stack_used >> 8);
+    p[4] = (UINT8)sampled;
+    p[5] = (UINT8)(sampled >> 8);
+    memcpy(&p[6], proximity_diag_pool_peak, PROXIMITY_POOL_MAX);
+}
+
+// Add the memory characteristic value to the metrics blob
+void proximity_diag_add_metrics(PROXIMITY_TLV_WRITER *p_tlv)
+{
+    UINT8 *p = proximity_tlv_add(p_tlv, PROXIMITY_TLV_MEMORY, PROXIMITY_TLV_MEMORY_SIZE);
+
+    if (p != NULL)
+        proximity_diag_memory_value(p);
+}
+
+static void proximity_diag_update_memory(void)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+
+    db_pdu.len = PROXIMITY_DIAG_MEMORY_SIZE;
+    proximity_diag_memory_value(db_pdu.pdu);
+    bleprofile_WriteHandle(HANDLE_PROX_DIAG_MEMORY_VALUE, &db_pdu);
+
+    proximity_send_notification(HANDLE_PROX_DIAG_MEMORY_CFG_DESC, HANDLE_PROX_DIAG_MEMORY_VALUE, db_pdu.pdu, db_pdu.len);
+}
+
+// Periodic scan, only while a client can read the result
+void proximity_diag_timeout(void)
+{
+    proximity_diag_scan_stack();
+    proximity_diag_update_memory();
+
+    if (!proximity_link_is_connected())
+        proximity_timer_stop(&proximity_diag_timer);
+}
+
+void proximity_diag_connection_up(void)
+{
+    proximity_timer_start(&proximity_diag_timer, PROXIMITY_DIAG_SCAN_INTERVAL, PROXIMITY_DIAG_SCAN_INTERVAL,
+                          PROXIMITY_DIAG_SCAN_SLACK, proximity_diag_timeout);
+
+    ble_trace3("diag: stack painted:%d used:%d sampled:%d\n", proximity_diag_paint_size,
+               proximity_diag_stack_used, proximity_diag_boot_sp - proximity_diag_min_sp);
+}
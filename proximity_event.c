@@ -0,0 +1,210 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity event queue
+*
+* Stack callbacks do the part that has to run in the callback, calling the ROM
+* handler and anything that must answer the stack, and post an event for the
+* rest of the application work.  Events are kept in a fixed ring of
+* PROXIMITY_EVENT_QUEUE_SIZE entries, there is no allocation.  The first event
+* posted to an empty queue serializes the dispatcher to the application
+* thread, which runs the queued events one by one to completion in the order
+* they were posted.  An event handler never runs inside a stack callback or
+* inside another handler.  If the dispatcher can not be serialized it is
+* tried again on the next post and on every fine timer tick.
+*
+* A timer tick posted right after another one that was not dispatched yet is
+* merged into it, so a late dispatcher does not fill the queue with ticks.
+* Events that still do not fit are counted as dropped.
+*
+* For every event type the number of events, the average and maximum time
+* from post to dispatch and the longest handler run time in CPU cycles are
+* kept and included in the metrics blob.  The queue depth is reported as a
+* pool of the memory characteristic.
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "bleapputils.h"
+#include "bleappevent.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+#define PROXIMITY_EVENT_QUEUE_SIZE              8
+
+typedef struct
+{
+    UINT32  count;
+    UINT32  latency_total;              // native clocks
+    UINT32  latency_max;
+    UINT32  run_max;                    // CPU cycles
+} PROXIMITY_EVENT_STATS;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+PROXIMITY_EVENT proximity_event_queue[PROXIMITY_EVENT_QUEUE_SIZE];
+UINT8  proximity_event_head;            // next event to dispatch
+UINT8  proximity_event_count;
+BOOL32 proximity_event_scheduled;
+UINT32 proximity_event_dropped;
+
+PROXIMITY_EVENT_STATS proximity_event_stats[PROXIMITY_EVENT_MAX];
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+static int proximity_event_dispatch(void *data)
+{
+    PROXIMITY_EVENT event;
+    PROXIMITY_EVENT_STATS *p_stats;
+    UINT32 latency;
+
+    proximity_event_scheduled = FALSE;
+
+    while (proximity_event_count != 0)
+    {
+        // Copy out and free the slot first, handlers may post new events
+        event = proximity_event_queue[proximity_event_head];
+        proximity_event_head = (proximity_event_head + 1) % PROXIMITY_EVENT_QUEUE_SIZE;
+        proximity_event_count--;
+
+        p_stats = &proximity_event_stats[event.type];
+        latency = bleapputils_diffNativeBtClks(event.clk, bleapputils_currentNativeBtClk());
+        p_stats->count++;
+        p_stats->latency_total += latency;
+        if (latency > p_stats->latency_max)
+            p_stats->latency_max = latency;
+
+        {
+            PROXIMITY_PROBE_START(start);
+
+            proximity_event_handlers[event.type](&event);
+
+            if (PROXIMITY_DWT_CYCCNT - start > p_stats->run_max)
+                p_stats->run_max = PROXIMITY_DWT_CYCCNT - start;
+        }
+    }
+    return 0;
+}
+
+BOOL32 proximity_event_pending(void)
+{
+    return proximity_event_count != 0;
+}
+
+// Serialize the dispatcher unless it is already waiting to run
+static void proximity_event_schedule(void)
+{
+    if (!proximity_event_scheduled && (proximity_event_count != 0))
+    {
+        proximity_event_scheduled = TRUE;
+        if (!bleappevt_serialize(proximity_event_dispatch, NULL))
+        {
+            proximity_event_scheduled = FALSE;
+            ble_trace0("event: serialize failed\n");
+        }
+    }
+}
+
+// Queue event, returns FALSE if the queue is full
+BOOL32 proximity_event_post(UINT8 type, UINT32 param)
+{
+    PROXIMITY_EVENT *p_event = NULL;
+
+    if (proximity_event_count != 0)
+    {
+        p_event = &proximity_event_queue[(proximity_event_head + proximity_event_count - 1) % PROXIMITY_EVENT_QUEUE_SIZE];
+        if ((type == PROXIMITY_EVENT_TIMEOUT) && (p_event->type == PROXIMITY_EVENT_TIMEOUT))
+        {
+            p_event->param += param;
+            proximity_event_schedule();
+            return TRUE;
+        }
+    }
+
+    if (proximity_event_count == PROXIMITY_EVENT_QUEUE_SIZE)
+    {
+        proximity_event_dropped++;
+        ble_trace1("event: queue full, dropped type:%d\n", type);
+        proximity_event_schedule();
+        return FALSE;
+    }
+
+    p_event = &proximity_event_queue[(proximity_event_head + proximity_event_count) % PROXIMITY_EVENT_QUEUE_SIZE];
+    p_event->type  = type;
+    p_event->param = param;
+    p_event->clk   = bleapputils_currentNativeBtClk();
+    proximity_event_count++;
+
+    proximity_diag_pool_use(PROXIMITY_POOL_EVENT, proximity_event_count);
+
+    proximity_event_schedule();
+    return TRUE;
+}
+
+// Retry serializing the dispatcher if that failed before
+void proximity_event_fine_timeout(void)
+{
+    proximity_event_schedule();
+}
+
+void proximity_event_add_metrics(PROXIMITY_TLV_WRITER *p_tlv)
+{
+    UINT8 *p = proximity_tlv_add(p_tlv, PROXIMITY_TLV_EVENT, PROXIMITY_TLV_EVENT_SIZE);
+    UINT8 type;
+
+    if (p == NULL)
+        return;
+
+    proximity_tlv_put32(p, proximity_event_dropped);
+    p += 4;
+
+    for (type = 0; type < PROXIMITY_EVENT_MAX; type++, p += 16)
+    {
+        PROXIMITY_EVENT_STATS *p_stats = &proximity_event_stats[type];
+        UINT32 average = p_stats->count ? p_stats->latency_total / p_stats->count : 0;
+
+        proximity_tlv_put32(&p[0], p_stats->count);
+        proximity_tlv_put32(&p[4], PROXIMITY_NATIVE_CLKS_TO_USEC(average));
+        proximity_tlv_put32(&p[8], PROXIMITY_NATIVE_CLKS_TO_USEC(p_stats->latency_max));
+        proximity_tlv_put32(&p[12], p_stats->run_max);
+    }
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity GPIO interrupt deferral
+*
+* The interrupt handlers of the button and battery monitoring GPIOs only take
+* a timestamp, read the pin state and add an entry to a single producer,
+* single consumer ring.  The ring is lock free: the handler is the only
+* writer of the head index and the drain function the only writer of the
+* tail index, both free running 8 bit counters.  The first entry after the
+* ring was drained serializes the drain function to the application thread
+* where the work for the entries runs.  If the drain can not be serialized it
+* is tried again on the next interrupt and on every fine timer tick
+*  - button  : edges closer than PROXIMITY_GPIO_DEBOUNCE_MSEC to the previous
+*              one are not passed on, the button is read again on the first
+*              fine timer tick after the debounce window and the settled state
+*              is passed on if it changed.  Presses are counted and the button
+*              state is passed to the ROM button handler bleprox_IntCb
+*  - battery : broadcast battery level is refreshed right away instead of on
+*              the next timer tick
+*
+* The profile library keeps a single application interrupt callback, which
+* bleprox_Create sets to bleprox_IntCb.  Registering the button handler here
+* after bleprox_Create replaces it, so the ROM button handling (advertising
+* start, alert stop) no longer runs in interrupt context and only runs from
+* the drain.  The ROM application does not take interrupts on the battery
+* pin, that one is registered with the GPIO driver directly.
+*
+* Interrupts, ring overflows, the longest handler run in CPU cycles and the
+* longest time from interrupt to work are included in the metrics blob, the
+* ring depth is reported as a pool of the memory characteristic.
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "bleapputils.h"
+#include "bleappevent.h"
+#include "gpiodriver.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+#define PROXIMITY_GPIO_QUEUE_SIZE           8       // power of 2
+#define PROXIMITY_GPIO_QUEUE_MASK           (PROXIMITY_GPIO_QUEUE_SIZE - 1)
+
+#define PROXIMITY_GPIO_DEBOUNCE_MSEC        30
+
+// Index of the pins in bleprox_gpio_cfg
+#define PROXIMITY_GPIO_INDEX_BUTTON         1
+#define PROXIMITY_GPIO_INDEX_BATTERY        3
+
+// Button state passed to the application interrupt callback, bit set when pressed
+#define PROXIMITY_GPIO_BUTTON_PRESSED       0x01
+
+// Keep the compiler from moving the entry writes after the index update
+#define PROXIMITY_GPIO_BARRIER()            __asm volatile ("" ::: "memory")
+
+typedef struct
+{
+    UINT8   gpio;
+    UINT8   level;                          // pin level, button state for the button
+    UINT32  clk;                            // native clock in the interrupt
+} PROXIMITY_GPIO_ENTRY;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+PROXIMITY_GPIO_ENTRY proximity_gpio_queue[PROXIMITY_GPIO_QUEUE_SIZE];
+volatile UINT8  proximity_gpio_head;        // written by the interrupt handler only
+volatile UINT8  proximity_gpio_tail;        // written by the drain function only
+volatile BOOL32 proximity_gpio_scheduled;
+
+// written by the interrupt handlers
+volatile UINT32 proximity_gpio_interrupts;
+volatile UINT32 proximity_gpio_overflows;
+volatile UINT32 proximity_gpio_isr_max;     // CPU cycles
+
+UINT32 proximity_gpio_latency_max;          // native clocks
+UINT32 proximity_gpio_button_presses;
+UINT32 proximity_gpio_button_clk;
+UINT8  proximity_gpio_button_level;        // last state passed to the ROM handler
+BOOL32 proximity_gpio_button_settle;       // edge ignored, read again after the debounce window
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+// Pass a new button state to the ROM button handler
+static void proximity_gpio_button_forward(UINT8 level, UINT32 clk)
+{
+    proximity_gpio_button_clk   = clk;
+    proximity_gpio_button_level = level;
+
+    if (level & PROXIMITY_GPIO_BUTTON_PRESSED)
+        proximity_gpio_button_presses++;
+
+    bleprox_IntCb(level);
+
+    // Button may have started advertising
+    proximity_adv_resume();
+}
+
+static void proximity_gpio_button(PROXIMITY_GPIO_ENTRY *p_entry)
+{
+    if (PROXIMITY_NATIVE_CLKS_TO_MSEC(bleapputils_diffNativeBtClks(proximity_gpio_button_clk, p_entry->clk)) < PROXIMITY_GPIO_DEBOUNCE_MSEC)
+    {
+        // Bouncing, or a tap shorter than the window, the state is read when it ends
+        proximity_gpio_button_settle = TRUE;
+        return;
+    }
+
+    proximity_gpio_button_settle = FALSE;
+    if (p_entry->level != proximity_gpio_button_level)
+        proximity_gpio_button_forward(p_entry->level, p_entry->clk);
+}
+
+// Pass on the settled button state once the debounce window has ended
+static void proximity_gpio_button_settled(void)
+{
+    UINT32 now = bleapputils_currentNativeBtClk();
+    UINT8  level;
+
+    // Entries still queued are handled first, they may be newer than the window
+    if (!proximity_gpio_button_settle || (proximity_gpio_tail != proximity_gpio_head) ||
+        (PROXIMITY_NATIVE_CLKS_TO_MSEC(bleapputils_diffNativeBtClks(proximity_gpio_button_clk, now)) < PROXIMITY_GPIO_DEBOUNCE_MSEC))
+    {
+        return;
+    }
+
+    proximity_gpio_button_settle = FALSE;
+    level = bleprofile_ReadButton();     // same encoding as the interrupt callback value
+    if (level != proximity_gpio_button_level)
+        proximity_gpio_button_forward(level, now);
+}
+
+// Runs in the application thread
+static int proximity_gpio_drain(void *data)
+{
+    PROXIMITY_GPIO_ENTRY *p_entry;
+    UINT32 latency;
+
+    proximity_gpio_scheduled = FALSE;
+
+    while (proximity_gpio_tail != proximity_gpio_head)
+    {
+        p_entry = &proximity_gpio_queue[proximity_gpio_tail & PROXIMITY_GPIO_QUEUE_MASK];
+
+        latency = bleapputils_diffNativeBtClks(p_entry->clk, bleapputils_currentNativeBtClk());
+        if (latency > proximity_gpio_latency_max)
+            proximity_gpio_latency_max = latency;
+
+        if (p_entry->gpio == bleprox_gpio_cfg.gpio_pin[PROXIMITY_GPIO_INDEX_BUTTON])
+            proximity_gpio_button(p_entry);
+        else if (p_entry->gpio == bleprox_gpio_cfg.gpio_pin[PROXIMITY_GPIO_INDEX_BATTERY])
+            proximity_adv_timeout();
+
+        PROXIMITY_GPIO_BARRIER();
+        proximity_gpio_tail++;
+    }
+    return 0;
+}
+
+// Serialize the drain function unless it is already waiting to run
+static void proximity_gpio_schedule(void)
+{
+    if (!proximity_gpio_scheduled && (proximity_gpio_tail != proximity_gpio_head))
+    {
+        proximity_gpio_scheduled = TRUE;
+        if (!bleappevt_serialize(proximity_gpio_drain, NULL))
+            proximity_gpio_scheduled = FALSE;
+    }
+}
+
+// Queue an entry, called from the interrupt handlers
+static void proximity_gpio_enqueue(UINT8 gpio, UINT8 level, UINT32 start)
+{
+    PROXIMITY_GPIO_ENTRY *p_entry;
+    UINT8 depth = proximity_gpio_head - proximity_gpio_tail;
+
+    proximity_gpio_interrupts++;
+
+    if (depth == PROXIMITY_GPIO_QUEUE_SIZE)
+    {
+        proximity_gpio_overflows++;
+    }
+    else
+    {
+        p_entry = &proximity_gpio_queue[proximity_gpio_head & PROXIMITY_GPIO_QUEUE_MASK];
+        p_entry->gpio  = gpio;
+        p_entry->level = level;
+        p_entry->clk   = bleapputils_currentNativeBtClk();
+
+        PROXIMITY_GPIO_BARRIER();
+        proximity_gpio_head++;
+        proximity_diag_pool_use(PROXIMITY_POOL_GPIO, depth + 1);
+    }
+
+    proximity_gpio_schedule();
+
+    if (PROXIMITY_DWT_CYCCNT - start > proximity_gpio_isr_max)
+        proximity_gpio_isr_max = PROXIMITY_DWT_CYCCNT - start;
+}
+
+// Application interrupt callback of the profile library, value is the button state
+static void proximity_gpio_button_interrupt(UINT8 value)
+{
+    PROXIMITY_PROBE_START(start);
+
+    proximity_gpio_enqueue(bleprox_gpio_cfg.gpio_pin[PROXIMITY_GPIO_INDEX_BUTTON], value, start);
+
+    PROXIMITY_PROBE_STOP(PROXIMITY_PROBE_GPIO_BUTTON, start);
+}
+
+// GPIO driver interrupt handler, arg is the GPIO that interrupted
+static void proximity_gpio_battery_interrupt(void *parameter, UINT8 arg)
+{
+    PROXIMITY_PROBE_START(start);
+
+    proximity_gpio_enqueue(arg, gpio_getPinInput(arg / 16, arg % 16), start);
+
+    PROXIMITY_PROBE_STOP(PROXIMITY_PROBE_GPIO_BATTERY, start);
+}
+
+// Must be called after bleprox_Create, see the file header
+void proximity_gpio_init(void)
+{
+    UINT16 masks[3] = { 0, 0, 0 };
+    INT8   gpio;
+
+    if (bleprox_gpio_cfg.gpio_pin[PROXIMITY_GPIO_INDEX_BUTTON] >= 0)
+        bleprofile_regIntCb(proximity_gpio_button_interrupt);
+
+    gpio = bleprox_gpio_cfg.gpio_pin[PROXIMITY_GPIO_INDEX_BATTERY];
+    if (gpio >= 0)
+    {
+        masks[gpio / 16] |= 1 << (gpio % 16);
+        gpio_registerForInterrupt(masks, proximity_gpio_battery_interrupt, NULL);
+    }
+}
+
+// Retry serializing the drain function if that failed before, finish the
+// button debounce
+void proximity_gpio_fine_timeout(void)
+{
+    proximity_gpio_schedule();
+    proximity_gpio_button_settled();
+}
+
+// TRUE if a button press can wake the device from power off
+BOOL32 proximity_gpio_wake_configured(void)
+{
+    return (bleprox_gpio_cfg.gpio_pin[PROXIMITY_GPIO_INDEX_BUTTON] >= 0) &&
+           (bleprox_gpio_cfg.gpio_flag[PROXIMITY_GPIO_INDEX_BUTTON] & GPIO_INT);
+}
+
+void proximity_gpio_add_metrics(PROXIMITY_TLV_WRITER *p_tlv)
+{
+    UINT8 *p = proximity_tlv_add(p_tlv, PROXIMITY_TLV_GPIO, PROXIMITY_TLV_GPIO_SIZE);
+
+    if (p != NULL)
+    {
+        proximity_tlv_put32(&p[0], proximity_gpio_interrupts);
+        proximity_tlv_put32(&p[4], proximity_gpio_overflows);
+        proximity_tlv_put32(&p[8], proximity_gpio_isr_max);
+        proximity_tlv_put32(&p[12], PROXIMITY_NATIVE_CLKS_TO_USEC(proximity_gpio_latency_max));
+        proximity_tlv_put32(&p[16], proximity_gpio_button_presses);
+    }
+}
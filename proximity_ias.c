@@ -0,0 +1,227 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity Immediate Alert rate limiter
+*
+* The Immediate Alert level is written with write without response, so a
+* client can write it in every connection event and each write would restart
+* the alert in the ROM handler.  Writes are passed to the ROM handler at most
+* once per PROXIMITY_IAS_MIN_INTERVAL_MSEC.  Writes in between are collapsed:
+* only the last level written is kept, and when the interval has passed the
+* fine timer writes it back to the database and passes the freshly looked up
+* entry on if it differs from the level the ROM handler saw last.  A client repeating the same level is ignored until it
+* has been quiet for the interval.  Writes that stop the alert are passed on
+* right away.
+*
+* Alerts accepted by the signed alert service share the same limiter, they are
+* written to the Immediate Alert level and passed on by handle.
+*
+* The ROM handler beeps the buzzer and blinks the LED for a number of times
+* set in the profile configuration.  The alert is taken as running for that
+* long after a level other than 0 was passed on, or after a link loss with
+* the Link Loss alert level set, so that the sleep governor does not power
+* off in the middle of it.
+*
+* Writes, writes passed to the ROM handler and collapsed writes are included
+* in the metrics blob.
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "bleapputils.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+#define PROXIMITY_IAS_MIN_INTERVAL_MSEC     500
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+UINT32 proximity_ias_forward_clk;
+UINT32 proximity_ias_write_clk;
+UINT8  proximity_ias_level;                 // last level passed to the ROM handler
+UINT8  proximity_ias_written;               // last level written by the client
+BOOL32 proximity_ias_pending;
+UINT32 proximity_ias_alert_clk;             // start of the last alert
+BOOL32 proximity_ias_alerting;
+
+UINT32 proximity_ias_writes;
+UINT32 proximity_ias_forwarded;
+UINT32 proximity_ias_collapsed;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+static UINT32 proximity_ias_msec_since(UINT32 clk, UINT32 now)
+{
+    return PROXIMITY_NATIVE_CLKS_TO_MSEC(bleapputils_diffNativeBtClks(clk, now));
+}
+
+// Entry is only valid during the write callback, NULL when called later
+static int proximity_ias_forward(LEGATTDB_ENTRY_HDR *p, UINT32 now)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+
+    if (p == NULL)
+    {
+        db_pdu.len    = 1;
+        db_pdu.pdu[0] = proximity_ias_written;
+        bleprofile_WriteHandle(HANDLE_PROX_IMMEDIATE_ALERT_LEVEL, &db_pdu);
+
+        if ((p = legattdb_findCharacteristic(HANDLE_PROX_IMMEDIATE_ALERT_LEVEL)) == NULL)
+            return 0;
+    }
+
+    proximity_ias_level       = proximity_ias_written;
+    proximity_ias_forward_clk = now;
+    proximity_ias_pending     = FALSE;
+    proximity_ias_alert_clk   = now;
+    proximity_ias_alerting    = (proximity_ias_level != 0);
+    proximity_ias_forwarded++;
+
+    return bleprox_writeCb(p);
+}
+
+// New alert level, from the write callback with its entry or NULL otherwise
+static int proximity_ias_level_write(LEGATTDB_ENTRY_HDR *p, UINT8 level)
+{
+    UINT32 now   = bleapputils_currentNativeBtClk();
+    BOOL32 quiet = (proximity_ias_writes == 0) ||
+                   (proximity_ias_msec_since(proximity_ias_write_clk, now) >= PROXIMITY_IAS_MIN_INTERVAL_MSEC);
+
+    proximity_ias_written   = level;
+    proximity_ias_write_clk = now;
+    proximity_ias_writes++;
+
+    // Stopping the alert costs nothing and is never delayed
+    if ((proximity_ias_forwarded == 0) || ((level == 0) && (proximity_ias_level != 0)) ||
+        ((proximity_ias_msec_since(proximity_ias_forward_clk, now) >= PROXIMITY_IAS_MIN_INTERVAL_MSEC) &&
+         (quiet || (level != proximity_ias_level))))
+    {
+        return proximity_ias_forward(p, now);
+    }
+
+    proximity_ias_pending = TRUE;
+    proximity_ias_collapsed++;
+    return 0;
+}
+
+// Write to the Immediate Alert level
+int proximity_ias_write(LEGATTDB_ENTRY_HDR *p)
+{
+    return proximity_ias_level_write(p, *legattdb_getAttrValue(p));
+}
+
+// Alert accepted by another service
+void proximity_ias_alert(UINT8 level)
+{
+    proximity_ias_level_write(NULL, level);
+}
+
+// Pass on the last collapsed level once the interval has passed
+void proximity_ias_fine_timeout(void)
+{
+    UINT32 now;
+
+    if (!proximity_ias_pending)
+        return;
+
+    now = bleapputils_currentNativeBtClk();
+    if (proximity_ias_msec_since(proximity_ias_forward_clk, now) < PROXIMITY_IAS_MIN_INTERVAL_MSEC)
+        return;
+
+    if (proximity_ias_written != proximity_ias_level)
+        proximity_ias_forward(NULL, now);
+    else
+        proximity_ias_pending = FALSE;
+}
+
+// Alert of the link that went down must not be restarted on the next one
+void proximity_ias_connection_down(void)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+
+    proximity_ias_pending = FALSE;
+
+    // ROM handler starts the link loss alert
+    bleprofile_ReadHandle(HANDLE_PROX_LINK_LOSS_ALERT_LEVEL, &db_pdu);
+    if (db_pdu.pdu[0] != 0)
+    {
+        proximity_ias_alert_clk = bleapputils_currentNativeBtClk();
+        proximity_ias_alerting  = TRUE;
+    }
+}
+
+// TRUE while an alert may still be beeping or blinking
+BOOL32 proximity_ias_alert_active(void)
+{
+    UINT32 duration_ms;
+    UINT8  count = proximity_cfg.high_alert_num;
+
+    if (proximity_ias_pending)
+        return TRUE;
+
+    if (!proximity_ias_alerting)
+        return FALSE;
+
+    if (proximity_cfg.mild_alert_num > count)
+        count = proximity_cfg.mild_alert_num;
+    duration_ms = (UINT32)(proximity_cfg.led_on_ms + proximity_cfg.led_off_ms) * count;
+    if (proximity_cfg.buz_on_ms > duration_ms)
+        duration_ms = proximity_cfg.buz_on_ms;
+
+    if (proximity_ias_msec_since(proximity_ias_alert_clk, bleapputils_currentNativeBtClk()) < duration_ms)
+        return TRUE;
+
+    proximity_ias_alerting = FALSE;
+    return FALSE;
+}
+
+void proximity_ias_add_metrics(PROXIMITY_TLV_WRITER *p_tlv)
+{
+    UINT8 *p = proximity_tlv_add(p_tlv, PROXIMITY_TLV_IAS, PROXIMITY_TLV_IAS_SIZE);
+
+    if (p != NULL)
+    {
+        proximity_tlv_put32(&p[0], proximity_ias_writes);
+        proximity_tlv_put32(&p[4], proximity_ias_forwarded);
+        proximity_tlv_put32(&p[8], proximity_ias_collapsed);
+    }
+}
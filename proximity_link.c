@@ -0,0 +1,204 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity link statistics
+*
+* The 20736 controller does not report per connection event results to the
+* application, so the statistics are collected from what the application sees
+* of the link.  Connection events are derived from the connection interval and
+* the time the connection has been up.  The interval is checked every second,
+* when it changed the events counted so far are kept and counting starts over
+* with the new interval, so events are summed per interval segment.  Data PDUs
+* are counted in the GATT write handler and when notifications are sent, reads,
+* ATT responses and link layer control PDUs are not seen by the application
+* and not counted.  The disconnection reason tells a supervision timeout, which
+* is the radio dropping out, from a disconnection requested by either side.
+*
+* Statistics are reset in the connection up callback of the stack, before any
+* write of the new connection is counted.
+*
+* Statistics of the current or last connection are available in the metrics
+* blob and in the link characteristic of the diagnostics service
+*  - connection events (4)
+*  - data PDUs received (4)
+*  - data PDUs sent (4)
+*  - connection interval in 1.25 msec units (2)
+*  - reason of the last disconnection (1)
+*  - supervision timeouts since power up (1)
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "bleapputils.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+#define PROXIMITY_HCI_ERR_CONNECTION_TIMEOUT    0x08
+
+typedef struct
+{
+    UINT32  conn_events;
+    UINT32  data_rx;
+    UINT32  data_tx;
+    UINT16  conn_interval;
+    UINT8   disc_reason;
+    UINT8   supervision_timeouts;
+} PROXIMITY_LINK_STATS;
+
+PROXIMITY_BUILD_ASSERT(link_stats_size, sizeof(PROXIMITY_LINK_STATS) == PROXIMITY_LINK_STATS_SIZE);
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+PROXIMITY_LINK_STATS proximity_link_stats;
+
+UINT8  proximity_link_connected;
+PROXIMITY_TIMER proximity_link_timer;
+UINT32 proximity_link_segment_clk;          // start of the current interval segment
+UINT32 proximity_link_segment_events;       // events of the segments before
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+static void proximity_link_update_events(void)
+{
+    UINT32 now = bleapputils_currentNativeBtClk();
+    UINT16 interval;
+    UINT32 events = 0;
+
+    if (!proximity_link_connected)
+        return;
+
+    // Interval is 0 until the controller reports it
+    if (proximity_link_stats.conn_interval != 0)
+    {
+        events = bleapputils_diffNativeBtClks(proximity_link_segment_clk, now) /
+                 (proximity_link_stats.conn_interval * PROXIMITY_NATIVE_CLKS_PER_CONN_UNIT);
+    }
+
+    // Peer may have updated connection parameters, close the segment
+    interval = emconinfo_getConnInterval();
+    if (interval != proximity_link_stats.conn_interval)
+    {
+        proximity_link_segment_events     += events;
+        proximity_link_segment_clk         = now;
+        proximity_link_stats.conn_interval = interval;
+        events = 0;
+    }
+
+    proximity_link_stats.conn_events = proximity_link_segment_events + events;
+}
+
+static void proximity_link_update_value(void)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+
+    db_pdu.len = PROXIMITY_LINK_STATS_SIZE;
+    memcpy(db_pdu.pdu, &proximity_link_stats, PROXIMITY_LINK_STATS_SIZE);
+    bleprofile_WriteHandle(HANDLE_PROX_DIAG_LINK_VALUE, &db_pdu);
+}
+
+// Add statistics of the current or last connection to the metrics blob
+void proximity_link_add_metrics(PROXIMITY_TLV_WRITER *p_tlv)
+{
+    UINT8 *p = proximity_tlv_add(p_tlv, PROXIMITY_TLV_LINK, PROXIMITY_TLV_LINK_SIZE);
+
+    proximity_link_update_events();
+    if (p != NULL)
+        memcpy(p, &proximity_link_stats, PROXIMITY_LINK_STATS_SIZE);
+}
+
+// Called from the connection up callback of the stack
+void proximity_link_connection_up(void)
+{
+    UINT8 supervision_timeouts = proximity_link_stats.supervision_timeouts;
+
+    memset(&proximity_link_stats, 0, sizeof(proximity_link_stats));
+    proximity_link_stats.supervision_timeouts = supervision_timeouts;
+    proximity_link_stats.conn_interval        = emconinfo_getConnInterval();
+
+    proximity_link_segment_clk    = bleapputils_currentNativeBtClk();
+    proximity_link_segment_events = 0;
+    proximity_link_connected      = TRUE;
+
+    proximity_timer_start(&proximity_link_timer, 1, 1, 0, proximity_link_timeout);
+}
+
+void proximity_link_connection_down(void)
+{
+    proximity_link_update_events();
+    proximity_link_connected = FALSE;
+    proximity_timer_stop(&proximity_link_timer);
+
+    proximity_link_stats.disc_reason = emconinfo_getDiscReason();
+    if ((proximity_link_stats.disc_reason == PROXIMITY_HCI_ERR_CONNECTION_TIMEOUT) &&
+        (proximity_link_stats.supervision_timeouts != 0xff))
+    {
+        proximity_link_stats.supervision_timeouts++;
+    }
+    proximity_link_update_value();
+
+    ble_trace3("link: events:%d rx:%d tx:%d\n", proximity_link_stats.conn_events,
+               proximity_link_stats.data_rx, proximity_link_stats.data_tx);
+    ble_trace3("link: interval:%d reason:%d timeouts:%d\n", proximity_link_stats.conn_interval,
+               proximity_link_stats.disc_reason, proximity_link_stats.supervision_timeouts);
+}
+
+BOOL32 proximity_link_is_connected(void)
+{
+    return proximity_link_connected;
+}
+
+void proximity_link_data_rx(void)
+{
+    proximity_link_stats.data_rx++;
+}
+
+void proximity_link_data_tx(void)
+{
+    proximity_link_stats.data_tx++;
+}
+
+// Refresh statistics of the connection every second while connected
+void proximity_link_timeout(void)
+{
+    proximity_link_update_events();
+    proximity_link_update_value();
+}
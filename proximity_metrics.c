@@ -0,0 +1,298 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity metrics blob
+*
+* All runtime metrics of the application are collected in one versioned blob
+* so that fleet tools can fetch them in a single exchange.  The client writes
+* SNAPSHOT to the metrics characteristic of the diagnostics service and the
+* blob is streamed in notifications, PROXIMITY_METRICS_FRAGMENT_SIZE bytes each.
+* The fragments are paced by the fine timer so that the blob does not exhaust
+* the notification buffers of the stack.
+*
+* The blob is not kept in RAM.  Every record has a fixed size and is always
+* included, so the layout of the blob does not change while it is sent, and on
+* each fine timer tick only the fragments sent on that tick are generated.  The
+* values in a fragment are read when the fragment is generated.
+*
+* Blob layout
+*  - version (1)
+*  - flags (1), 0
+*  - length of the records that follow (2)
+*  - records, each type (1), length (1), value
+* Record types are listed in proximity.h.  Clients skip types they do not know.
+*
+* Commands written to the metrics characteristic
+*  - SNAPSHOT : build the blob and start sending it
+*  - RESET    : clear statistics of the profiling probes
+*  - TRACE    : dump statistics of the profiling probes on the PUART
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+#define PROXIMITY_METRICS_CMD_SNAPSHOT          0x01
+#define PROXIMITY_METRICS_CMD_RESET             0x02
+#define PROXIMITY_METRICS_CMD_TRACE             0x03
+
+#define PROXIMITY_METRICS_ERR_PARAM             0x81
+#define PROXIMITY_METRICS_ERR_BUSY              0x82
+
+#define PROXIMITY_METRICS_HEADER_SIZE           4
+
+// Size of all records, a record added to the blob must be added here
+#define PROXIMITY_METRICS_RECORD(size)          (2 + (size))
+#define PROXIMITY_METRICS_RECORDS_SIZE                                                                                   \
+    (PROXIMITY_METRICS_RECORD(PROXIMITY_TLV_LINK_SIZE) + PROXIMITY_METRICS_RECORD(PROXIMITY_TLV_BATTERY_SIZE) +          \
+     PROXIMITY_METRICS_RECORD(PROXIMITY_TLV_MEMORY_SIZE) + PROXIMITY_METRICS_RECORD(PROXIMITY_TLV_NVRAM_SIZE) +          \
+     PROXIMITY_METRICS_RECORD(PROXIMITY_TLV_PAIRING_SIZE) + PROXIMITY_METRICS_RECORD(PROXIMITY_TLV_TIMER_SIZE) +         \
+     PROXIMITY_METRICS_RECORD(PROXIMITY_TLV_EVENT_SIZE) + PROXIMITY_METRICS_RECORD(PROXIMITY_TLV_SLEEP_SIZE) +           \
+     PROXIMITY_METRICS_RECORD(PROXIMITY_TLV_GPIO_SIZE) + PROXIMITY_METRICS_RECORD(PROXIMITY_TLV_IAS_SIZE) +              \
+     PROXIMITY_PROBE_MAX * (PROXIMITY_METRICS_RECORD(PROXIMITY_TLV_PROBE_SIZE) + PROXIMITY_METRICS_RECORD(PROXIMITY_TLV_PROBE_HISTOGRAM_SIZE)))
+
+#define PROXIMITY_METRICS_SIZE                  (PROXIMITY_METRICS_HEADER_SIZE + PROXIMITY_METRICS_RECORDS_SIZE)
+#define PROXIMITY_METRICS_FRAGMENT_SIZE         20
+#define PROXIMITY_METRICS_FRAGMENTS_PER_TICK    4
+
+// Value of the record being added is written here, must hold the largest one
+#define PROXIMITY_METRICS_VALUE_SIZE            PROXIMITY_TLV_EVENT_SIZE
+
+// Record length is one byte, blob length two
+PROXIMITY_BUILD_ASSERT(metrics_size, PROXIMITY_METRICS_SIZE <= 0xffff);
+PROXIMITY_BUILD_ASSERT(metrics_value_size, PROXIMITY_METRICS_VALUE_SIZE <= 0xff);
+PROXIMITY_BUILD_ASSERT(metrics_histogram_size, PROXIMITY_TLV_PROBE_HISTOGRAM_SIZE <= PROXIMITY_METRICS_VALUE_SIZE);
+PROXIMITY_BUILD_ASSERT(metrics_pairing_size, PROXIMITY_TLV_PAIRING_SIZE <= PROXIMITY_METRICS_VALUE_SIZE);
+PROXIMITY_BUILD_ASSERT(metrics_memory_size, PROXIMITY_TLV_MEMORY_SIZE <= PROXIMITY_METRICS_VALUE_SIZE);
+PROXIMITY_BUILD_ASSERT(metrics_gpio_size, PROXIMITY_TLV_GPIO_SIZE <= PROXIMITY_METRICS_VALUE_SIZE);
+PROXIMITY_BUILD_ASSERT(metrics_link_size, PROXIMITY_TLV_LINK_SIZE <= PROXIMITY_METRICS_VALUE_SIZE);
+PROXIMITY_BUILD_ASSERT(metrics_sleep_size, PROXIMITY_TLV_SLEEP_SIZE <= PROXIMITY_METRICS_VALUE_SIZE);
+PROXIMITY_BUILD_ASSERT(metrics_probe_size, PROXIMITY_TLV_PROBE_SIZE <= PROXIMITY_METRICS_VALUE_SIZE);
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+UINT8  proximity_metrics_value[PROXIMITY_METRICS_VALUE_SIZE];
+UINT8  proximity_metrics_fragments[PROXIMITY_METRICS_FRAGMENT_SIZE * PROXIMITY_METRICS_FRAGMENTS_PER_TICK];
+UINT16 proximity_metrics_len;
+UINT16 proximity_metrics_sent;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+void proximity_tlv_put32(UINT8 *p, UINT32 value)
+{
+    p[0] = (UINT8)value;
+    p[1] = (UINT8)(value >> 8);
+    p[2] = (UINT8)(value >> 16);
+    p[3] = (UINT8)(value >> 24);
+}
+
+// Append bytes to the blob, only the ones in the part being generated are kept
+static void proximity_tlv_copy(PROXIMITY_TLV_WRITER *p_tlv, const UINT8 *p, UINT16 len)
+{
+    UINT16 from = p_tlv->len;
+    UINT16 to   = p_tlv->len + len;
+
+    if (from < p_tlv->offset)
+        from = p_tlv->offset;
+    if (to > p_tlv->offset + p_tlv->size)
+        to = p_tlv->offset + p_tlv->size;
+
+    if (from < to)
+        memcpy(&p_tlv->p[from - p_tlv->offset], &p[from - p_tlv->len], to - from);
+
+    p_tlv->len += len;
+}
+
+// Copy the value of the last record added
+static void proximity_tlv_flush(PROXIMITY_TLV_WRITER *p_tlv)
+{
+    proximity_tlv_copy(p_tlv, p_tlv->p_value, p_tlv->value_len);
+    p_tlv->value_len = 0;
+}
+
+// Add a record to the blob, returns pointer to where the value is written.
+// The value is copied to the blob on the next add.
+UINT8 *proximity_tlv_add(PROXIMITY_TLV_WRITER *p_tlv, UINT8 type, UINT8 len)
+{
+    UINT8 hdr[2];
+
+    if (len > PROXIMITY_METRICS_VALUE_SIZE)
+        return NULL;
+
+    proximity_tlv_flush(p_tlv);
+
+    hdr[0] = type;
+    hdr[1] = len;
+    proximity_tlv_copy(p_tlv, hdr, sizeof(hdr));
+
+    p_tlv->p_value   = proximity_metrics_value;
+    p_tlv->value_len = len;
+    return proximity_metrics_value;
+}
+
+static void proximity_metrics_add_battery(PROXIMITY_TLV_WRITER *p_tlv)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+    UINT8 *p = proximity_tlv_add(p_tlv, PROXIMITY_TLV_BATTERY, PROXIMITY_TLV_BATTERY_SIZE);
+
+    if (p == NULL)
+        return;
+
+    bleprofile_ReadHandle(HANDLE_PROX_BATTERY_LEVEL, &db_pdu);
+    p[0] = db_pdu.pdu[0];
+    bleprofile_ReadHandle(HANDLE_PROX_BATTERY_POWER_STATE, &db_pdu);
+    p[1] = db_pdu.pdu[0];
+    bleprofile_ReadHandle(HANDLE_PROX_BATTERY_SERVICE_REQUIRED, &db_pdu);
+    p[2] = db_pdu.pdu[0];
+}
+
+// Generate the part of the blob from offset to offset + size
+static void proximity_metrics_generate(UINT8 *p, UINT16 offset, UINT16 size)
+{
+    PROXIMITY_TLV_WRITER tlv;
+    UINT8 hdr[PROXIMITY_METRICS_HEADER_SIZE];
+
+    tlv.p         = p;
+    tlv.offset    = offset;
+    tlv.size      = size;
+    tlv.len       = 0;
+    tlv.p_value   = NULL;
+    tlv.value_len = 0;
+
+    hdr[0] = PROXIMITY_METRICS_VERSION;
+    hdr[1] = 0;
+    hdr[2] = (UINT8)PROXIMITY_METRICS_RECORDS_SIZE;
+    hdr[3] = (UINT8)(PROXIMITY_METRICS_RECORDS_SIZE >> 8);
+    proximity_tlv_copy(&tlv, hdr, sizeof(hdr));
+
+    proximity_link_add_metrics(&tlv);
+    proximity_metrics_add_battery(&tlv);
+    proximity_diag_add_metrics(&tlv);
+    proximity_nvram_add_metrics(&tlv);
+    proximity_pairing_add_metrics(&tlv);
+    proximity_timer_add_metrics(&tlv);
+    proximity_event_add_metrics(&tlv);
+    proximity_sleep_add_metrics(&tlv);
+    proximity_gpio_add_metrics(&tlv);
+    proximity_ias_add_metrics(&tlv);
+    proximity_probe_add_metrics(&tlv);
+    proximity_tlv_flush(&tlv);
+
+    // A record that is not in PROXIMITY_METRICS_RECORDS_SIZE shifts the layout
+    if (tlv.len != PROXIMITY_METRICS_SIZE)
+        ble_trace1("metrics: blob size:%d\n", tlv.len);
+}
+
+void proximity_metrics_init(void)
+{
+    proximity_metrics_len  = 0;
+    proximity_metrics_sent = 0;
+}
+
+// Process write to the metrics characteristic
+int proximity_metrics_write_handler(LEGATTDB_ENTRY_HDR *p)
+{
+    UINT16  handle   = legattdb_getHandle(p);
+    int     len      = legattdb_getAttrValueLen(p);
+    UINT8   *attrPtr = legattdb_getAttrValue(p);
+
+    if (handle != HANDLE_PROX_DIAG_METRICS_VALUE)
+        return 0;
+
+    if (len != 1)
+        return PROXIMITY_METRICS_ERR_PARAM;
+
+    switch (attrPtr[0])
+    {
+    case PROXIMITY_METRICS_CMD_SNAPSHOT:
+        if (proximity_metrics_sent < proximity_metrics_len)
+            return PROXIMITY_METRICS_ERR_BUSY;
+        proximity_metrics_len  = PROXIMITY_METRICS_SIZE;
+        proximity_metrics_sent = 0;
+        return 0;
+
+    case PROXIMITY_METRICS_CMD_RESET:
+        proximity_probe_reset();
+        return 0;
+
+    case PROXIMITY_METRICS_CMD_TRACE:
+        proximity_probe_trace();
+        return 0;
+    }
+    return PROXIMITY_METRICS_ERR_PARAM;
+}
+
+// Generate and send next fragments of the blob
+void proximity_metrics_fine_timeout(void)
+{
+    UINT16 start = proximity_metrics_sent;
+    UINT8  fragments;
+    UINT8  len;
+
+    if (proximity_metrics_sent >= proximity_metrics_len)
+        return;
+
+    proximity_metrics_generate(proximity_metrics_fragments, start, sizeof(proximity_metrics_fragments));
+
+    for (fragments = 0; (fragments < PROXIMITY_METRICS_FRAGMENTS_PER_TICK) &&
+                        (proximity_metrics_sent < proximity_metrics_len); fragments++)
+    {
+        len = (proximity_metrics_len - proximity_metrics_sent > PROXIMITY_METRICS_FRAGMENT_SIZE) ?
+              PROXIMITY_METRICS_FRAGMENT_SIZE : (UINT8)(proximity_metrics_len - proximity_metrics_sent);
+
+        if (!proximity_send_notification(HANDLE_PROX_DIAG_METRICS_CFG_DESC, HANDLE_PROX_DIAG_METRICS_VALUE,
+                                         &proximity_metrics_fragments[proximity_metrics_sent - start], len))
+        {
+            // client is not listening, drop the rest of the blob
+            proximity_metrics_sent = proximity_metrics_len;
+            return;
+        }
+        proximity_metrics_sent += len;
+    }
+}
+
+void proximity_metrics_connection_down(void)
+{
+    proximity_metrics_len  = 0;
+    proximity_metrics_sent = 0;
+}
@@ -0,0 +1,568 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity over the air firmware upgrade data path
+*
+* The updater writes the image through the OTA data characteristic using write
+* without response, so that several packets can be sent in one connection event.
+* Flow control is credit based: the fob advertises a window of packets the
+* updater may have outstanding and acknowledges the stream once every
+* PROXIMITY_OTA_ACK_INTERVAL packets with a notification on the control point.
+* A packet received out of sequence is dropped and answered with a single NAK
+* carrying the next expected sequence number, and the updater goes back to it.
+*
+* All OTA characteristics are only written on an encrypted link to a bonded
+* peer, the updater has to pair and encrypt before START.
+*
+* The image is split in chunks of PROXIMITY_OTA_CHUNK_SIZE bytes.  A chunk is
+* verified once all of its packets were received and it was written to the
+* upgrade storage.  Verified chunks are recorded in a bitmap that is saved in
+* NVRAM, so after the link drops the updater issues START with the same image
+* length and digest and only the missing chunks are transferred.  The next
+* expected sequence in ACK and NAK always points to the first packet of a
+* missing chunk, an updater that simply follows it skips chunks already stored.
+*
+* Because chunks may be stored in any order across connections the image is
+* checked with an order independent digest: the XOR over all chunks of the
+* CRC32 of the chunk index (2 bytes, little endian) followed by the chunk data.
+* The CRC is taken over the chunk read back from the upgrade storage, so VERIFY
+* checks what reached the storage, and a chunk already marked in the bitmap is
+* not stored or added to the digest again.
+*
+* Control point commands (written by the updater)
+*  - START  : total image length (4), image digest (4)
+*  - VERIFY : no parameters
+*  - APPLY  : no parameters, the fob reboots into the new image
+*  - ABORT  : no parameters, the saved chunk bitmap is discarded
+*  - QUERY  : no parameters, the fob replies with the chunk bitmap
+*
+* Control point notifications (sent by the fob)
+*  - READY    : credit window (1), acknowledge interval (1), payload size (1), chunks stored (2)
+*  - ACK      : next expected sequence (2), credit window (1)
+*  - NAK      : next expected sequence (2), credit window (1)
+*  - VERIFIED : status (1), effective throughput in bytes per second (4)
+*  - CHUNK_MAP: bitmap byte offset (1), up to PROXIMITY_OTA_CHUNK_MAP_EVT_BYTES bitmap bytes
+*
+*/
+
+#ifdef OTA_FW_UPGRADE
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "bleapputils.h"
+#include "string.h"
+#include "ws_upgrade.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+#define PROXIMITY_OTA_CMD_START             0x01
+#define PROXIMITY_OTA_CMD_VERIFY            0x02
+#define PROXIMITY_OTA_CMD_APPLY             0x03
+#define PROXIMITY_OTA_CMD_ABORT             0x04
+#define PROXIMITY_OTA_CMD_QUERY             0x05
+
+#define PROXIMITY_OTA_EVT_READY             0x81
+#define PROXIMITY_OTA_EVT_ACK               0x82
+#define PROXIMITY_OTA_EVT_NAK               0x83
+#define PROXIMITY_OTA_EVT_VERIFIED          0x84
+#define PROXIMITY_OTA_EVT_CHUNK_MAP         0x85
+
+#define PROXIMITY_OTA_STATUS_OK             0x00
+#define PROXIMITY_OTA_STATUS_BAD_LENGTH     0x01
+#define PROXIMITY_OTA_STATUS_BAD_DIGEST     0x02
+
+// ATT application error codes returned on control point writes
+#define PROXIMITY_OTA_ERR_STATE             0x80
+#define PROXIMITY_OTA_ERR_PARAM             0x81
+#define PROXIMITY_OTA_ERR_STORAGE           0x82
+
+// Number of packets the updater may send without waiting for an acknowledgement
+// and the number of in sequence packets acknowledged by one notification.  The
+// acknowledgement interval is kept at half of the window so that the updater
+// gets new credits before it runs out of them and the pipeline never drains.
+#define PROXIMITY_OTA_CREDIT_WINDOW         8
+#define PROXIMITY_OTA_ACK_INTERVAL          (PROXIMITY_OTA_CREDIT_WINDOW / 2)
+
+// Chunk is the unit passed to the upgrade storage and tracked in the bitmap
+#define PROXIMITY_OTA_PACKETS_PER_CHUNK     8
+#define PROXIMITY_OTA_CHUNK_SIZE            (PROXIMITY_OTA_PACKETS_PER_CHUNK * PROXIMITY_OTA_PAYLOAD_SIZE)
+#define PROXIMITY_OTA_MAX_IMAGE_SIZE        0x10000
+#define PROXIMITY_OTA_MAX_CHUNKS            (PROXIMITY_OTA_MAX_IMAGE_SIZE / PROXIMITY_OTA_CHUNK_SIZE)
+#define PROXIMITY_OTA_CHUNK_MAP_SIZE        (PROXIMITY_OTA_MAX_CHUNKS / 8)
+#define PROXIMITY_OTA_CHUNK_MAP_EVT_BYTES   18
+
+// Bitmap is saved to NVRAM every few chunks and when the link goes down
+#define PROXIMITY_OTA_SAVE_INTERVAL         8
+
+// Connection parameters requested for the duration of the transfer, 1.25 msec units
+#define PROXIMITY_OTA_CONN_INTERVAL_MIN     6
+#define PROXIMITY_OTA_CONN_INTERVAL_MAX     12
+#define PROXIMITY_OTA_CONN_TIMEOUT          200
+
+enum
+{
+    PROXIMITY_OTA_STATE_IDLE,
+    PROXIMITY_OTA_STATE_RECEIVING,
+    PROXIMITY_OTA_STATE_VERIFIED,
+};
+
+// Transfer progress saved in NVRAM
+typedef struct
+{
+    UINT32  image_len;
+    UINT32  image_digest;                               // digest announced by the updater
+    UINT32  digest;                                     // digest of the chunks stored so far
+    UINT8   chunk_map[PROXIMITY_OTA_CHUNK_MAP_SIZE];    // bit set for every chunk stored
+} PROXIMITY_OTA_RESUME;
+
+typedef struct
+{
+    UINT8   state;
+    UINT8   nak_sent;           // NAK sent for the current gap, wait for the updater to go back
+    UINT8   since_ack;          // in sequence packets received since the last ACK
+    UINT8   unsaved;            // chunks stored since the bitmap was saved
+    UINT16  next_seq;
+    UINT16  num_chunks;
+    UINT16  chunks_stored;
+    UINT16  chunk_len;          // bytes of the current chunk received so far
+    UINT32  session_bytes;      // bytes stored in this connection
+    UINT32  start_clk;
+    UINT32  end_clk;
+    PROXIMITY_OTA_RESUME resume;
+    UINT8   chunk[PROXIMITY_OTA_CHUNK_SIZE];
+} PROXIMITY_OTA_STATE;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+PROXIMITY_OTA_STATE proximity_ota;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+static BOOL32 proximity_ota_chunk_stored(UINT16 chunk)
+{
+    return (proximity_ota.resume.chunk_map[chunk >> 3] & (1 << (chunk & 7))) != 0;
+}
+
+// Length of the chunk, only the last one may be short
+static UINT16 proximity_ota_chunk_size(UINT16 chunk)
+{
+    UINT32 left = proximity_ota.resume.image_len - (UINT32)chunk * PROXIMITY_OTA_CHUNK_SIZE;
+
+    return (left < PROXIMITY_OTA_CHUNK_SIZE) ? (UINT16)left : PROXIMITY_OTA_CHUNK_SIZE;
+}
+
+// Point next expected sequence to the first packet of the first missing chunk
+// at or after the given one, wrapping around to pick up earlier holes.
+static void proximity_ota_seek_missing(UINT16 chunk)
+{
+    UINT16 i;
+
+    for (i = 0; i < proximity_ota.num_chunks; i++, chunk++)
+    {
+        if (chunk >= proximity_ota.num_chunks)
+            chunk = 0;
+        if (!proximity_ota_chunk_stored(chunk))
+            break;
+    }
+    proximity_ota.next_seq  = chunk * PROXIMITY_OTA_PACKETS_PER_CHUNK;
+    proximity_ota.chunk_len = 0;
+}
+
+static void proximity_ota_save(void)
+{
+    if (proximity_ota.unsaved != 0)
+    {
+        proximity_write_nvram(PROXIMITY_VS_ID_OTA_RESUME, sizeof(PROXIMITY_OTA_RESUME), (UINT8 *)&proximity_ota.resume);
+        proximity_ota.unsaved = 0;
+    }
+}
+
+static void proximity_ota_discard(void)
+{
+    memset(&proximity_ota.resume, 0, sizeof(proximity_ota.resume));
+    bleprofile_DeleteNVRAM(PROXIMITY_VS_ID_OTA_RESUME);
+    proximity_ota.unsaved = 0;
+}
+
+// Send notification on the control point if the updater registered for it
+static void proximity_ota_send_event(UINT8 *p, UINT8 len)
+{
+    proximity_send_notification(HANDLE_PROX_OTA_CONTROL_POINT_CFG_DESC, HANDLE_PROX_OTA_CONTROL_POINT_VALUE, p, len);
+}
+
+static void proximity_ota_send_seq_event(UINT8 event)
+{
+    UINT8 evt[4];
+
+    evt[0] = event;
+    evt[1] = (UINT8)proximity_ota.next_seq;
+    evt[2] = (UINT8)(proximity_ota.next_seq >> 8);
+    evt[3] = PROXIMITY_OTA_CREDIT_WINDOW;
+    proximity_ota_send_event(evt, sizeof(evt));
+
+    proximity_ota.since_ack = 0;
+}
+
+static void proximity_ota_send_chunk_map(void)
+{
+    UINT8 evt[2 + PROXIMITY_OTA_CHUNK_MAP_EVT_BYTES];
+    UINT8 map_len = (proximity_ota.num_chunks + 7) / 8;
+    UINT8 offset;
+    UINT8 len;
+
+    for (offset = 0; offset < map_len; offset += len)
+    {
+        len = map_len - offset;
+        if (len > PROXIMITY_OTA_CHUNK_MAP_EVT_BYTES)
+            len = PROXIMITY_OTA_CHUNK_MAP_EVT_BYTES;
+
+        evt[0] = PROXIMITY_OTA_EVT_CHUNK_MAP;
+        evt[1] = offset;
+        memcpy(&evt[2], &proximity_ota.resume.chunk_map[offset], len);
+        proximity_ota_send_event(evt, 2 + len);
+    }
+}
+
+// Pass completed chunk to the upgrade storage and mark it in the bitmap
+static BOOL32 proximity_ota_store_chunk(UINT16 chunk)
+{
+    UINT8  index[2];
+    UINT32 crc;
+
+    // Retransmitted chunk, already in the digest
+    if (proximity_ota_chunk_stored(chunk))
+        return TRUE;
+
+    if (ws_upgrade_write((UINT32)chunk * PROXIMITY_OTA_CHUNK_SIZE, proximity_ota.chunk, proximity_ota.chunk_len) != proximity_ota.chunk_len)
+    {
+        ble_trace1("ota: storage write failed chunk %d\n", chunk);
+        return FALSE;
+    }
+
+    // Digest covers the stored data, the chunk buffer is reused for the read back
+    if (ws_upgrade_read((UINT32)chunk * PROXIMITY_OTA_CHUNK_SIZE, proximity_ota.chunk, proximity_ota.chunk_len) != proximity_ota.chunk_len)
+    {
+        ble_trace1("ota: storage read failed chunk %d\n", chunk);
+        return FALSE;
+    }
+
+    index[0] = (UINT8)chunk;
+    index[1] = (UINT8)(chunk >> 8);
+    crc = proximity_crc32(0xffffffff, index, sizeof(index));
+    crc = proximity_crc32(crc, proximity_ota.chunk, proximity_ota.chunk_len);
+
+    proximity_ota.resume.digest ^= crc ^ 0xffffffff;
+    proximity_ota.resume.chunk_map[chunk >> 3] |= (1 << (chunk & 7));
+    proximity_ota.chunks_stored++;
+    proximity_ota.session_bytes += proximity_ota.chunk_len;
+
+    if (++proximity_ota.unsaved >= PROXIMITY_OTA_SAVE_INTERVAL)
+    {
+        proximity_ota_save();
+    }
+    return TRUE;
+}
+
+static void proximity_ota_close(void)
+{
+    if (proximity_ota.state == PROXIMITY_OTA_STATE_RECEIVING)
+    {
+        proximity_ota_save();
+        ws_upgrade_close();
+    }
+    proximity_ota.state = PROXIMITY_OTA_STATE_IDLE;
+}
+
+static int proximity_ota_start(UINT8 *data, int len)
+{
+    UINT8  evt[6];
+    UINT32 image_len;
+    UINT32 image_digest;
+    UINT16 chunk;
+
+    if (len != 9)
+        return PROXIMITY_OTA_ERR_PARAM;
+
+    image_len    = data[1] | (data[2] << 8) | (data[3] << 16) | (data[4] << 24);
+    image_digest = data[5] | (data[6] << 8) | (data[7] << 16) | (data[8] << 24);
+    if ((image_len == 0) || (image_len > PROXIMITY_OTA_MAX_IMAGE_SIZE))
+        return PROXIMITY_OTA_ERR_PARAM;
+
+    proximity_ota_close();
+
+    // Different image invalidates whatever was stored for the previous one
+    if ((image_len != proximity_ota.resume.image_len) || (image_digest != proximity_ota.resume.image_digest))
+    {
+        proximity_ota_discard();
+        proximity_ota.resume.image_len    = image_len;
+        proximity_ota.resume.image_digest = image_digest;
+    }
+
+    if (!ws_upgrade_open())
+        return PROXIMITY_OTA_ERR_STORAGE;
+
+    proximity_ota.num_chunks    = (image_len + PROXIMITY_OTA_CHUNK_SIZE - 1) / PROXIMITY_OTA_CHUNK_SIZE;
+    proximity_ota.chunks_stored = 0;
+    for (chunk = 0; chunk < proximity_ota.num_chunks; chunk++)
+    {
+        if (proximity_ota_chunk_stored(chunk))
+            proximity_ota.chunks_stored++;
+    }
+    proximity_ota.session_bytes = 0;
+    proximity_ota.since_ack     = 0;
+    proximity_ota.nak_sent      = FALSE;
+    proximity_ota.state         = PROXIMITY_OTA_STATE_RECEIVING;
+    proximity_ota_seek_missing(0);
+
+    // Shorter connection interval gives more connection events per second to fill
+    bleprofile_SendConnParamUpdateReq(PROXIMITY_OTA_CONN_INTERVAL_MIN, PROXIMITY_OTA_CONN_INTERVAL_MAX,
+                                      0, PROXIMITY_OTA_CONN_TIMEOUT);
+
+    ble_trace3("ota: start len:%d chunks:%d stored:%d\n", image_len, proximity_ota.num_chunks, proximity_ota.chunks_stored);
+
+    evt[0] = PROXIMITY_OTA_EVT_READY;
+    evt[1] = PROXIMITY_OTA_CREDIT_WINDOW;
+    evt[2] = PROXIMITY_OTA_ACK_INTERVAL;
+    evt[3] = PROXIMITY_OTA_PAYLOAD_SIZE;
+    evt[4] = (UINT8)proximity_ota.chunks_stored;
+    evt[5] = (UINT8)(proximity_ota.chunks_stored >> 8);
+    proximity_ota_send_event(evt, sizeof(evt));
+    return 0;
+}
+
+static int proximity_ota_verify(void)
+{
+    UINT8  evt[6];
+    UINT32 elapsed;
+    UINT32 rate = 0;
+
+    if (proximity_ota.state != PROXIMITY_OTA_STATE_RECEIVING)
+        return PROXIMITY_OTA_ERR_STATE;
+
+    evt[0] = PROXIMITY_OTA_EVT_VERIFIED;
+    if (proximity_ota.chunks_stored != proximity_ota.num_chunks)
+    {
+        evt[1] = PROXIMITY_OTA_STATUS_BAD_LENGTH;
+    }
+    else if (proximity_ota.resume.digest != proximity_ota.resume.image_digest)
+    {
+        // Stored data is useless, start over next time
+        evt[1] = PROXIMITY_OTA_STATUS_BAD_DIGEST;
+        proximity_ota_close();
+        proximity_ota_discard();
+    }
+    else
+    {
+        evt[1] = PROXIMITY_OTA_STATUS_OK;
+        proximity_ota_save();
+        proximity_ota.state = PROXIMITY_OTA_STATE_VERIFIED;
+    }
+
+    // Effective throughput of this connection from the first to the last data packet
+    elapsed = bleapputils_diffNativeBtClks(proximity_ota.start_clk, proximity_ota.end_clk);
+    if (elapsed != 0)
+    {
+        rate = (proximity_ota.session_bytes * PROXIMITY_NATIVE_CLKS_PER_SEC) / elapsed;
+    }
+    ble_trace3("ota: verify status:%d bytes:%d rate:%d B/s\n", evt[1], proximity_ota.session_bytes, rate);
+
+    evt[2] = (UINT8)rate;
+    evt[3] = (UINT8)(rate >> 8);
+    evt[4] = (UINT8)(rate >> 16);
+    evt[5] = (UINT8)(rate >> 24);
+    proximity_ota_send_event(evt, sizeof(evt));
+    return 0;
+}
+
+static int proximity_ota_control_point(UINT8 *data, int len)
+{
+    if (len < 1)
+        return PROXIMITY_OTA_ERR_PARAM;
+
+    switch (data[0])
+    {
+    case PROXIMITY_OTA_CMD_START:
+        return proximity_ota_start(data, len);
+
+    case PROXIMITY_OTA_CMD_VERIFY:
+        return proximity_ota_verify();
+
+    case PROXIMITY_OTA_CMD_APPLY:
+        if (proximity_ota.state != PROXIMITY_OTA_STATE_VERIFIED)
+            return PROXIMITY_OTA_ERR_STATE;
+        ble_trace0("ota: apply\n");
+        proximity_ota_discard();
+        ws_upgrade_finish();
+        return 0;
+
+    case PROXIMITY_OTA_CMD_ABORT:
+        proximity_ota_close();
+        proximity_ota_discard();
+        return 0;
+
+    case PROXIMITY_OTA_CMD_QUERY:
+        if (proximity_ota.state != PROXIMITY_OTA_STATE_RECEIVING)
+            return PROXIMITY_OTA_ERR_STATE;
+        proximity_ota_send_chunk_map();
+        return 0;
+    }
+    return PROXIMITY_OTA_ERR_PARAM;
+}
+
+static int proximity_ota_data(UINT8 *data, int len)
+{
+    UINT16 seq;
+    UINT16 chunk;
+    UINT16 chunk_size;
+    UINT16 payload_len = len - 2;
+
+    if ((proximity_ota.state != PROXIMITY_OTA_STATE_RECEIVING) || (len <= 2))
+        return PROXIMITY_OTA_ERR_STATE;
+
+    seq   = data[0] | (data[1] << 8);
+    chunk = seq / PROXIMITY_OTA_PACKETS_PER_CHUNK;
+
+    // Updater may start any missing chunk, the partially received one is dropped
+    if ((seq != proximity_ota.next_seq) && ((seq % PROXIMITY_OTA_PACKETS_PER_CHUNK) == 0) &&
+        (chunk < proximity_ota.num_chunks) && !proximity_ota_chunk_stored(chunk))
+    {
+        proximity_ota.next_seq  = seq;
+        proximity_ota.chunk_len = 0;
+    }
+
+    if (seq != proximity_ota.next_seq)
+    {
+        // Updater overran a lost packet, ask it once to go back to the gap
+        if (!proximity_ota.nak_sent)
+        {
+            ble_trace2("ota: got seq %d expected %d\n", seq, proximity_ota.next_seq);
+            proximity_ota_send_seq_event(PROXIMITY_OTA_EVT_NAK);
+            proximity_ota.nak_sent = TRUE;
+        }
+        return 0;
+    }
+    proximity_ota.nak_sent = FALSE;
+
+    // only the last packet of the image may be short
+    chunk_size = proximity_ota_chunk_size(chunk);
+    if ((proximity_ota.chunk_len + payload_len > chunk_size) ||
+        ((payload_len != PROXIMITY_OTA_PAYLOAD_SIZE) && (proximity_ota.chunk_len + payload_len != chunk_size)))
+    {
+        return PROXIMITY_OTA_ERR_PARAM;
+    }
+
+    if (proximity_ota.session_bytes == 0 && proximity_ota.chunk_len == 0)
+    {
+        proximity_ota.start_clk = bleapputils_currentNativeBtClk();
+    }
+
+    memcpy(&proximity_ota.chunk[proximity_ota.chunk_len], &data[2], payload_len);
+    proximity_ota.chunk_len += payload_len;
+    proximity_ota.next_seq++;
+
+    if (proximity_ota.chunk_len == chunk_size)
+    {
+        if (!proximity_ota_store_chunk(chunk))
+        {
+            proximity_ota_close();
+            return PROXIMITY_OTA_ERR_STORAGE;
+        }
+        proximity_ota_seek_missing(chunk + 1);
+        proximity_ota.end_clk = bleapputils_currentNativeBtClk();
+
+        if (proximity_ota.chunks_stored == proximity_ota.num_chunks)
+        {
+            proximity_ota_save();
+            proximity_ota_send_seq_event(PROXIMITY_OTA_EVT_ACK);
+            return 0;
+        }
+    }
+
+    if (++proximity_ota.since_ack >= PROXIMITY_OTA_ACK_INTERVAL)
+    {
+        proximity_ota_send_seq_event(PROXIMITY_OTA_EVT_ACK);
+    }
+    return 0;
+}
+
+// Restore progress of the transfer interrupted before the last reset
+void proximity_ota_init(void)
+{
+    memset(&proximity_ota, 0, sizeof(proximity_ota));
+
+    if (bleprofile_ReadNVRAM(PROXIMITY_VS_ID_OTA_RESUME, sizeof(PROXIMITY_OTA_RESUME), (UINT8 *)&proximity_ota.resume) != sizeof(PROXIMITY_OTA_RESUME))
+    {
+        memset(&proximity_ota.resume, 0, sizeof(proximity_ota.resume));
+    }
+    else
+    {
+        ble_trace1("ota: resumable image len:%d\n", proximity_ota.resume.image_len);
+    }
+}
+
+// Process write to one of the OTA service attributes
+int proximity_ota_write_handler(LEGATTDB_ENTRY_HDR *p)
+{
+    UINT16  handle   = legattdb_getHandle(p);
+    int     len      = legattdb_getAttrValueLen(p);
+    UINT8   *attrPtr = legattdb_getAttrValue(p);
+
+    switch (handle)
+    {
+    case HANDLE_PROX_OTA_CONTROL_POINT_VALUE:
+        return proximity_ota_control_point(attrPtr, len);
+
+    case HANDLE_PROX_OTA_DATA_VALUE:
+        return proximity_ota_data(attrPtr, len);
+    }
+    return 0;
+}
+
+// Keep what was stored so that the updater can resume on the next connection
+void proximity_ota_connection_down(void)
+{
+    if (proximity_ota.state != PROXIMITY_OTA_STATE_IDLE)
+    {
+        ble_trace2("ota: link lost, %d of %d chunks stored\n", proximity_ota.chunks_stored, proximity_ota.num_chunks);
+        proximity_ota_close();
+    }
+}
+
+#endif // OTA_FW_UPGRADE
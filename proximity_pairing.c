@@ -0,0 +1,151 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity pairing and encryption timing
+*
+* First time setup of the fob is split in phases timed with the native
+* Bluetooth clock
+*  - encryption     : connection up until the link is encrypted for the first
+*                     time.  Covers the pairing request, pairing confirm and
+*                     random exchange and the short term key generation.
+*  - key exchange   : link encrypted until the pairing result.  Covers the key
+*                     distribution round trips.
+*  - bond write     : time spent in the ROM pairing result handler, which saves
+*                     the bond to NVRAM.
+*  - reconnect      : connection up until the link is encrypted with the keys of
+*                     an existing bond.
+* The last, minimum and maximum duration of every phase in msec are traced and
+* included in the metrics blob.
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "bleapputils.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+enum
+{
+    PROXIMITY_PAIRING_PHASE_ENCRYPTION,
+    PROXIMITY_PAIRING_PHASE_KEY_EXCHANGE,
+    PROXIMITY_PAIRING_PHASE_BOND_WRITE,
+    PROXIMITY_PAIRING_PHASE_RECONNECT,
+    PROXIMITY_PAIRING_PHASE_MAX
+};
+
+typedef struct
+{
+    UINT16  count;
+    UINT16  last;
+    UINT16  min;
+    UINT16  max;
+} PROXIMITY_PAIRING_PHASE;
+
+// Metrics record is sized in proximity.h
+PROXIMITY_BUILD_ASSERT(pairing_size, sizeof(PROXIMITY_PAIRING_PHASE) * PROXIMITY_PAIRING_PHASE_MAX == PROXIMITY_TLV_PAIRING_SIZE);
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+PROXIMITY_PAIRING_PHASE proximity_pairing_phases[PROXIMITY_PAIRING_PHASE_MAX];
+
+UINT32 proximity_pairing_up_clk;
+UINT32 proximity_pairing_encrypted_clk;
+UINT8  proximity_pairing_encrypted;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+static void proximity_pairing_record(UINT8 phase, UINT32 from_clk, UINT32 to_clk)
+{
+    PROXIMITY_PAIRING_PHASE *p_phase = &proximity_pairing_phases[phase];
+    UINT32 msec = PROXIMITY_NATIVE_CLKS_TO_MSEC(bleapputils_diffNativeBtClks(from_clk, to_clk));
+
+    if (msec > 0xffff)
+        msec = 0xffff;
+
+    if ((p_phase->count == 0) || (msec < p_phase->min))
+        p_phase->min = (UINT16)msec;
+    if (msec > p_phase->max)
+        p_phase->max = (UINT16)msec;
+    if (p_phase->count != 0xffff)
+        p_phase->count++;
+    p_phase->last = (UINT16)msec;
+
+    ble_trace2("pairing: phase:%d %d msec\n", phase, msec);
+}
+
+// Times are native clocks taken in the stack callbacks
+void proximity_pairing_connection_up(UINT32 clk)
+{
+    proximity_pairing_up_clk    = clk;
+    proximity_pairing_encrypted = FALSE;
+}
+
+// Bonded tells if the keys came from an existing bond
+void proximity_pairing_encryption_changed(BOOL32 bonded, UINT32 clk)
+{
+    if (proximity_pairing_encrypted)
+        return;
+
+    proximity_pairing_encrypted     = TRUE;
+    proximity_pairing_encrypted_clk = clk;
+
+    proximity_pairing_record(bonded ? PROXIMITY_PAIRING_PHASE_RECONNECT : PROXIMITY_PAIRING_PHASE_ENCRYPTION,
+                             proximity_pairing_up_clk, proximity_pairing_encrypted_clk);
+}
+
+// start_clk was taken before the ROM handler was called, end_clk after it returned
+void proximity_pairing_bond_result(UINT32 start_clk, UINT32 end_clk)
+{
+    if (proximity_pairing_encrypted)
+    {
+        proximity_pairing_record(PROXIMITY_PAIRING_PHASE_KEY_EXCHANGE, proximity_pairing_encrypted_clk, start_clk);
+    }
+    proximity_pairing_record(PROXIMITY_PAIRING_PHASE_BOND_WRITE, start_clk, end_clk);
+}
+
+void proximity_pairing_add_metrics(PROXIMITY_TLV_WRITER *p_tlv)
+{
+    UINT8 *p = proximity_tlv_add(p_tlv, PROXIMITY_TLV_PAIRING, PROXIMITY_TLV_PAIRING_SIZE);
+
+    if (p != NULL)
+        memcpy(p, proximity_pairing_phases, sizeof(proximity_pairing_phases));
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity callback profiling probes
+*
+* Every application callback and GPIO interrupt handler is bracketed by reads
+* of the Cortex-M3 DWT cycle counter.  For each callback the probe table keeps
+* the number of calls, minimum, average and maximum duration in CPU cycles and
+* a log2 histogram of the durations.  The table is fixed in RAM and does not
+* allocate.  Each entry is only updated from its own callback, so the
+* interrupt handlers record without locking.
+*
+* Statistics are exported on the PUART through the trace and in the metrics
+* blob of the diagnostics service, see proximity_metrics.c.
+* Bucket 0 counts calls shorter than 128 cycles, bucket n counts calls of
+* 2^(n+6) up to 2^(n+7) cycles and the last bucket collects everything longer.
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+#define PROXIMITY_PROBE_BUCKET_SHIFT        6
+
+#define PROXIMITY_DEMCR_TRCENA              (1 << 24)
+#define PROXIMITY_DWT_CTRL_CYCCNTENA        (1 << 0)
+
+typedef struct
+{
+    UINT32  count;
+    UINT32  min;
+    UINT32  max;
+    UINT64  total;
+    UINT16  hist[PROXIMITY_PROBE_BUCKETS];
+} PROXIMITY_PROBE_STATS;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+PROXIMITY_PROBE_STATS proximity_probe_stats[PROXIMITY_PROBE_MAX];
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+// Enable the DWT cycle counter and clear the probe table
+void proximity_probe_init(void)
+{
+    PROXIMITY_SCB_DEMCR |= PROXIMITY_DEMCR_TRCENA;
+    PROXIMITY_DWT_CYCCNT = 0;
+    PROXIMITY_DWT_CTRL  |= PROXIMITY_DWT_CTRL_CYCCNTENA;
+
+    memset(proximity_probe_stats, 0, sizeof(proximity_probe_stats));
+}
+
+void proximity_probe_record(UINT8 id, UINT32 cycles)
+{
+    PROXIMITY_PROBE_STATS *p_stats = &proximity_probe_stats[id];
+    UINT32 bucket = 0;
+
+    PROXIMITY_STACK_SAMPLE();
+
+    if ((p_stats->count == 0) || (cycles < p_stats->min))
+        p_stats->min = cycles;
+    if (cycles > p_stats->max)
+        p_stats->max = cycles;
+    p_stats->count++;
+    p_stats->total += cycles;
+
+    if (cycles >> (PROXIMITY_PROBE_BUCKET_SHIFT + 1))
+    {
+        bucket = 31 - __builtin_clz(cycles) - PROXIMITY_PROBE_BUCKET_SHIFT;
+        if (bucket >= PROXIMITY_PROBE_BUCKETS)
+            bucket = PROXIMITY_PROBE_BUCKETS - 1;
+    }
+    if (p_stats->hist[bucket] != 0xffff)
+        p_stats->hist[bucket]++;
+}
+
+static UINT32 proximity_probe_average(PROXIMITY_PROBE_STATS *p_stats)
+{
+    return p_stats->count ? (UINT32)(p_stats->total / p_stats->count) : 0;
+}
+
+// Dump the probe table to the PUART
+void proximity_probe_trace(void)
+{
+    PROXIMITY_PROBE_STATS *p_stats;
+    UINT8 id;
+
+    for (id = 0; id < PROXIMITY_PROBE_MAX; id++)
+    {
+        p_stats = &proximity_probe_stats[id];
+        if (p_stats->count == 0)
+            continue;
+
+        ble_trace2("probe:%d calls:%d\n", id, p_stats->count);
+        ble_trace3("  min:%d avg:%d max:%d\n", p_stats->min, proximity_probe_average(p_stats), p_stats->max);
+        ble_tracen((char *)p_stats->hist, sizeof(p_stats->hist));
+    }
+}
+
+// Clear statistics of all probes
+void proximity_probe_reset(void)
+{
+    memset(proximity_probe_stats, 0, sizeof(proximity_probe_stats));
+}
+
+// Add statistics of every probe to the metrics blob, with all histogram
+// buckets.  The blob is generated in parts, so the records of the probes must
+// not depend on the values.
+void proximity_probe_add_metrics(PROXIMITY_TLV_WRITER *p_tlv)
+{
+    PROXIMITY_PROBE_STATS *p_stats;
+    UINT8 *p;
+    UINT8 id;
+    UINT8 i;
+
+    for (id = 0; id < PROXIMITY_PROBE_MAX; id++)
+    {
+        p_stats = &proximity_probe_stats[id];
+
+        if ((p = proximity_tlv_add(p_tlv, PROXIMITY_TLV_PROBE, PROXIMITY_TLV_PROBE_SIZE)) == NULL)
+            return;
+        p[0] = id;
+        proximity_tlv_put32(&p[1], p_stats->count);
+        proximity_tlv_put32(&p[5], p_stats->min);
+        proximity_tlv_put32(&p[9], proximity_probe_average(p_stats));
+        proximity_tlv_put32(&p[13], p_stats->max);
+
+        if ((p = proximity_tlv_add(p_tlv, PROXIMITY_TLV_PROBE_HISTOGRAM, PROXIMITY_TLV_PROBE_HISTOGRAM_SIZE)) == NULL)
+            return;
+        p[0] = id;
+        p[1] = 0;
+        for (i = 0; i < PROXIMITY_PROBE_BUCKETS; i++)
+        {
+            p[2 + 2 * i]     = (UINT8)p_stats->hist[i];
+            p[2 + 2 * i + 1] = (UINT8)(p_stats->hist[i] >> 8);
+        }
+    }
+}
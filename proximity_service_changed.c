@@ -0,0 +1,403 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity Service Changed tracking
+*
+* A client that bonded with the device may cache the attribute handles and
+* must be told with a Service Changed indication when the database changes,
+* for example after a firmware upgrade.  Telling every client on every
+* connection makes all of them run service discovery again, so the
+* indication is only sent to the bonds that connected before the change,
+* once, on their next encrypted reconnect.
+*
+* At start up the database is split in services and a CRC of every service is
+* compared with the table saved by the previous firmware.  The handles of the
+* services that were added, removed or changed give the affected range, which
+* is added to the pending range of every known bond.  The table of services
+* and the pending ranges are kept in one NVRAM record.
+*
+* A bond becomes known when pairing completes.  A bonded peer that reconnects
+* without pairing but is not in the record, because there was no record yet
+* or its slot was reused, may have cached any handle and is sent the whole
+* range 0x0001-0xffff.
+*
+* The indication is only sent when the bond enabled it in the Client
+* Characteristic Configuration of the Service Changed characteristic.  The
+* configuration is kept with the bond and restored when the link is
+* encrypted, until then the range stays pending.  A configuration the client
+* wrote on the same link before encryption is kept and saved with the bond.
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+#define PROXIMITY_SERVICE_CHANGED_MAX_SERVICES  12
+#define PROXIMITY_SERVICE_CHANGED_MAX_BONDS     2
+
+// Primary service declaration: handle (2), permission, length, UUID 0x2800
+#define PROXIMITY_SERVICE_DECL_HEADER_SIZE      6
+
+#define PROXIMITY_SERVICE_CHANGED_CCCD_INDICATE 0x0002
+
+typedef struct
+{
+    UINT16  start;
+    UINT16  end;
+    UINT32  crc;
+} PROXIMITY_SERVICE_SIGNATURE;
+
+typedef struct
+{
+    UINT8   bd_addr[6];
+    UINT16  start;                          // pending range, 0 if none
+    UINT16  end;
+    UINT16  cccd;                           // client characteristic configuration
+} PROXIMITY_SERVICE_CHANGED_BOND;
+
+typedef struct
+{
+    UINT8   services;
+    UINT8   reserved[3];
+    PROXIMITY_SERVICE_SIGNATURE     service[PROXIMITY_SERVICE_CHANGED_MAX_SERVICES];
+    PROXIMITY_SERVICE_CHANGED_BOND  bond[PROXIMITY_SERVICE_CHANGED_MAX_BONDS];
+} PROXIMITY_SERVICE_CHANGED_STATE;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+PROXIMITY_SERVICE_CHANGED_STATE proximity_service_changed;
+
+// Bond of the connected peer while the indication is waiting for confirmation
+INT8 proximity_service_changed_peer = -1;
+
+// Configuration of the connected peer, written by it or restored from its bond
+UINT16 proximity_service_changed_cccd;
+BOOL32 proximity_service_changed_cccd_written;     // by the client on this link
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+static BOOL32 proximity_service_changed_is_service(const UINT8 *p, UINT16 prev_handle)
+{
+    UINT16 handle = p[0] | (p[1] << 8);
+
+    return (handle > prev_handle) &&
+           ((p[3] == 4) || (p[3] == 18)) &&
+           (p[4] == (UINT8)UUID_ATTRIBUTE_PRIMARY_SERVICE) &&
+           (p[5] == (UINT8)(UUID_ATTRIBUTE_PRIMARY_SERVICE >> 8));
+}
+
+// Split the database in services and sign each of them.  If the services can
+// not be found the whole database is signed as one.
+static UINT8 proximity_service_changed_sign(const UINT8 *p_db, UINT16 len, PROXIMITY_SERVICE_SIGNATURE *p_sig)
+{
+    UINT16 offset[PROXIMITY_SERVICE_CHANGED_MAX_SERVICES + 1];
+    UINT16 prev_handle = 0;
+    UINT8  count = 0;
+    UINT16 i;
+
+    for (i = 0; (i + PROXIMITY_SERVICE_DECL_HEADER_SIZE <= len) && (count < PROXIMITY_SERVICE_CHANGED_MAX_SERVICES); i++)
+    {
+        if (proximity_service_changed_is_service(&p_db[i], prev_handle))
+        {
+            prev_handle = p_db[i] | (p_db[i + 1] << 8);
+            p_sig[count].start = prev_handle;
+            offset[count++] = i;
+            i += PROXIMITY_SERVICE_DECL_HEADER_SIZE - 1;
+        }
+    }
+
+    if ((count == 0) || (count == PROXIMITY_SERVICE_CHANGED_MAX_SERVICES))
+    {
+        p_sig[0].start = 0x0001;
+        p_sig[0].end   = 0xffff;
+        p_sig[0].crc   = proximity_crc32(0xffffffff, (UINT8 *)p_db, len);
+        return 1;
+    }
+
+    offset[count] = len;
+    for (i = 0; i < count; i++)
+    {
+        p_sig[i].end = (i + 1 < count) ? p_sig[i + 1].start - 1 : 0xffff;
+        p_sig[i].crc = proximity_crc32(0xffffffff, (UINT8 *)&p_db[offset[i]], offset[i + 1] - offset[i]);
+    }
+    return count;
+}
+
+static BOOL32 proximity_service_changed_find(PROXIMITY_SERVICE_SIGNATURE *p_sig, PROXIMITY_SERVICE_SIGNATURE *p_table, UINT8 count)
+{
+    UINT8 i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (memcmp(p_sig, &p_table[i], sizeof(PROXIMITY_SERVICE_SIGNATURE)) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+// Widen the range to cover the services of the first table missing in the second
+static void proximity_service_changed_diff(PROXIMITY_SERVICE_SIGNATURE *p_a, UINT8 count_a,
+                                           PROXIMITY_SERVICE_SIGNATURE *p_b, UINT8 count_b,
+                                           UINT16 *p_start, UINT16 *p_end)
+{
+    UINT8 i;
+
+    for (i = 0; i < count_a; i++)
+    {
+        if (!proximity_service_changed_find(&p_a[i], p_b, count_b))
+        {
+            if ((*p_start == 0) || (p_a[i].start < *p_start))
+                *p_start = p_a[i].start;
+            if (p_a[i].end > *p_end)
+                *p_end = p_a[i].end;
+        }
+    }
+}
+
+static void proximity_service_changed_save(void)
+{
+    proximity_write_nvram(PROXIMITY_VS_ID_SERVICE_CHANGED, sizeof(proximity_service_changed), (UINT8 *)&proximity_service_changed);
+}
+
+// Compare the database with the one of the previous firmware and mark the
+// changed range pending for all known bonds
+void proximity_service_changed_init(const UINT8 *p_db, UINT16 len)
+{
+    PROXIMITY_SERVICE_SIGNATURE service[PROXIMITY_SERVICE_CHANGED_MAX_SERVICES];
+    UINT8  services = proximity_service_changed_sign(p_db, len, service);
+    UINT16 start = 0;
+    UINT16 end = 0;
+    UINT8  i;
+
+    if ((bleprofile_ReadNVRAM(PROXIMITY_VS_ID_SERVICE_CHANGED, sizeof(proximity_service_changed), (UINT8 *)&proximity_service_changed) != sizeof(proximity_service_changed)) ||
+        (proximity_service_changed.services > PROXIMITY_SERVICE_CHANGED_MAX_SERVICES))
+    {
+        // No record, bonds made before are not known and get the whole
+        // range when they reconnect
+        memset(&proximity_service_changed, 0, sizeof(proximity_service_changed));
+    }
+    else
+    {
+        proximity_service_changed_diff(service, services, proximity_service_changed.service, proximity_service_changed.services, &start, &end);
+        proximity_service_changed_diff(proximity_service_changed.service, proximity_service_changed.services, service, services, &start, &end);
+
+        if (start == 0)
+            return;
+    }
+
+    ble_trace2("service changed:%04x-%04x\n", start, end);
+
+    for (i = 0; (start != 0) && (i < PROXIMITY_SERVICE_CHANGED_MAX_BONDS); i++)
+    {
+        PROXIMITY_SERVICE_CHANGED_BOND *p_bond = &proximity_service_changed.bond[i];
+        BOOL32 used = FALSE;
+        UINT8  j;
+
+        for (j = 0; j < 6; j++)
+            used |= p_bond->bd_addr[j];
+
+        if (!used)
+            continue;
+
+        if ((p_bond->start == 0) || (start < p_bond->start))
+            p_bond->start = start;
+        if (end > p_bond->end)
+            p_bond->end = end;
+    }
+
+    proximity_service_changed.services = services;
+    memcpy(proximity_service_changed.service, service, sizeof(PROXIMITY_SERVICE_SIGNATURE) * services);
+    proximity_service_changed_save();
+}
+
+static void proximity_service_changed_confirmed(void)
+{
+    if (proximity_service_changed_peer >= 0)
+    {
+        PROXIMITY_SERVICE_CHANGED_BOND *p_bond = &proximity_service_changed.bond[proximity_service_changed_peer];
+
+        ble_trace2("service changed confirmed:%04x-%04x\n", p_bond->start, p_bond->end);
+
+        p_bond->start = 0;
+        p_bond->end   = 0;
+        proximity_service_changed_peer = -1;
+        proximity_service_changed_save();
+    }
+}
+
+static INT8 proximity_service_changed_find_bond(UINT8 *bd_addr)
+{
+    INT8 i;
+
+    for (i = 0; i < PROXIMITY_SERVICE_CHANGED_MAX_BONDS; i++)
+    {
+        if (memcmp(proximity_service_changed.bond[i].bd_addr, bd_addr, 6) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// Add the peer as the newest bond, the oldest one is replaced
+static PROXIMITY_SERVICE_CHANGED_BOND *proximity_service_changed_add_bond(UINT8 *bd_addr)
+{
+    memmove(&proximity_service_changed.bond[1], &proximity_service_changed.bond[0],
+            sizeof(PROXIMITY_SERVICE_CHANGED_BOND) * (PROXIMITY_SERVICE_CHANGED_MAX_BONDS - 1));
+    memset(&proximity_service_changed.bond[0], 0, sizeof(PROXIMITY_SERVICE_CHANGED_BOND));
+    memcpy(proximity_service_changed.bond[0].bd_addr, bd_addr, 6);
+    return &proximity_service_changed.bond[0];
+}
+
+static void proximity_service_changed_write_cccd(UINT16 cccd)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+
+    db_pdu.len    = 2;
+    db_pdu.pdu[0] = (UINT8)cccd;
+    db_pdu.pdu[1] = (UINT8)(cccd >> 8);
+    bleprofile_WriteHandle(HANDLE_PROX_SERVICE_CHANGED_CFG_DESC, &db_pdu);
+}
+
+// Pairing completed, the new bond discovers the current database
+void proximity_service_changed_bond_result(void)
+{
+    UINT8 *bd_addr = emconninfo_getPeerPubAddr();
+    PROXIMITY_SERVICE_CHANGED_BOND *p_bond;
+    INT8  i;
+
+    if (!emconninfo_deviceBonded())
+        return;
+
+    if ((i = proximity_service_changed_find_bond(bd_addr)) >= 0)
+        p_bond = &proximity_service_changed.bond[i];
+    else
+        p_bond = proximity_service_changed_add_bond(bd_addr);
+
+    p_bond->start = 0;
+    p_bond->end   = 0;
+    p_bond->cccd  = proximity_service_changed_cccd;
+    proximity_service_changed_save();
+}
+
+// Link is encrypted.  Restore the configuration of a known bond and send the
+// pending indication, bonds that are not known get the whole range.
+void proximity_service_changed_encryption_changed(BOOL32 bonded)
+{
+    UINT8 *bd_addr = emconninfo_getPeerPubAddr();
+    PROXIMITY_SERVICE_CHANGED_BOND *p_bond;
+    UINT8 data[4];
+    INT8  i;
+
+    if (!bonded)
+        return;
+
+    if ((i = proximity_service_changed_find_bond(bd_addr)) < 0)
+    {
+        p_bond = proximity_service_changed_add_bond(bd_addr);
+        p_bond->start = 0x0001;
+        p_bond->end   = 0xffff;
+        p_bond->cccd  = proximity_service_changed_cccd;
+        proximity_service_changed_save();
+        i = 0;
+    }
+
+    p_bond = &proximity_service_changed.bond[i];
+    if (!proximity_service_changed_cccd_written)
+    {
+        proximity_service_changed_cccd = p_bond->cccd;
+        proximity_service_changed_write_cccd(p_bond->cccd);
+    }
+    else if (p_bond->cccd != proximity_service_changed_cccd)
+    {
+        p_bond->cccd = proximity_service_changed_cccd;
+        proximity_service_changed_save();
+    }
+
+    if ((p_bond->start == 0) || !(p_bond->cccd & PROXIMITY_SERVICE_CHANGED_CCCD_INDICATE))
+        return;
+
+    data[0] = (UINT8)p_bond->start;
+    data[1] = (UINT8)(p_bond->start >> 8);
+    data[2] = (UINT8)p_bond->end;
+    data[3] = (UINT8)(p_bond->end >> 8);
+
+    proximity_service_changed_peer = i;
+    bleprofile_sendIndication(HANDLE_PROX_SERVICE_CHANGED_VALUE, data, sizeof(data), proximity_service_changed_confirmed);
+}
+
+// Indication not confirmed before the link went down stays pending.  The
+// configuration of the next peer starts cleared.
+void proximity_service_changed_connection_down(void)
+{
+    proximity_service_changed_peer = -1;
+    proximity_service_changed_cccd = 0;
+    proximity_service_changed_cccd_written = FALSE;
+    proximity_service_changed_write_cccd(0);
+}
+
+// Client characteristic configuration written, kept with the bond of the peer
+int proximity_service_changed_write_handler(LEGATTDB_ENTRY_HDR *p)
+{
+    UINT16  handle   = legattdb_getHandle(p);
+    int     len      = legattdb_getAttrValueLen(p);
+    UINT8   *attrPtr = legattdb_getAttrValue(p);
+    INT8    i;
+
+    if ((handle != HANDLE_PROX_SERVICE_CHANGED_CFG_DESC) || (len != 2))
+        return 0;
+
+    proximity_service_changed_cccd = attrPtr[0] | (attrPtr[1] << 8);
+    proximity_service_changed_cccd_written = TRUE;
+
+    if (proximity_link_encrypted && emconninfo_deviceBonded() &&
+        ((i = proximity_service_changed_find_bond(emconninfo_getPeerPubAddr())) >= 0) &&
+        (proximity_service_changed.bond[i].cccd != proximity_service_changed_cccd))
+    {
+        proximity_service_changed.bond[i].cccd = proximity_service_changed_cccd;
+        proximity_service_changed_save();
+
+        // Range that was waiting for the indication to be enabled
+        if ((proximity_service_changed.bond[i].start != 0) && (proximity_service_changed_peer < 0))
+            proximity_service_changed_encryption_changed(TRUE);
+    }
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity persistent attribute shadow
+*
+* The GATT database is built from the constant proximity_db_data table and
+* the stack keeps its own copy, so every value keeps its DROM default over a
+* reset.  The few values that have to survive a reset, the Link Loss alert
+* level and the Battery Level State broadcast configuration, are mirrored in a
+* small RAM shadow with a dirty bit per value.
+*
+* A write from the peer only updates the shadow.  The shadow is saved to NVRAM
+* with a single write once it has not changed for PROXIMITY_SHADOW_FLUSH_DELAY
+* seconds, up to PROXIMITY_SHADOW_FLUSH_SLACK seconds later to run with other
+* timers, or when the link goes down, so the flash is never written in the
+* GATT write path and a client toggling a value does not wear it.  At start up
+* the saved values are written back to the database.
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+#define PROXIMITY_SHADOW_FLUSH_DELAY    5       // seconds without change before the flush
+#define PROXIMITY_SHADOW_FLUSH_SLACK    5
+
+typedef struct
+{
+    UINT16  handle;
+    UINT8   offset;                     // in the shadow
+    UINT8   len;
+} PROXIMITY_SHADOW_ATTR;
+
+static const PROXIMITY_SHADOW_ATTR proximity_shadow_attrs[] =
+{
+    { HANDLE_PROX_LINK_LOSS_ALERT_LEVEL,    0, 1 },
+    { HANDLE_PROX_BATTERY_LEVEL_STATE_SCCD, 1, 2 },
+};
+
+#define PROXIMITY_SHADOW_ATTRS          (sizeof(proximity_shadow_attrs) / sizeof(proximity_shadow_attrs[0]))
+#define PROXIMITY_SHADOW_SIZE           3
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+UINT8  proximity_shadow[PROXIMITY_SHADOW_SIZE];
+UINT8  proximity_shadow_dirty;          // bit per entry of proximity_shadow_attrs
+PROXIMITY_TIMER proximity_shadow_timer;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+// Restore the saved values to the database
+void proximity_shadow_init(void)
+{
+    BLEPROFILE_DB_PDU db_pdu;
+    UINT8 i;
+
+    if (bleprofile_ReadNVRAM(PROXIMITY_VS_ID_SHADOW, sizeof(proximity_shadow), proximity_shadow) != sizeof(proximity_shadow))
+    {
+        // nothing saved yet, start from the database defaults
+        for (i = 0; i < PROXIMITY_SHADOW_ATTRS; i++)
+        {
+            bleprofile_ReadHandle(proximity_shadow_attrs[i].handle, &db_pdu);
+            memcpy(&proximity_shadow[proximity_shadow_attrs[i].offset], db_pdu.pdu, proximity_shadow_attrs[i].len);
+        }
+        return;
+    }
+
+    for (i = 0; i < PROXIMITY_SHADOW_ATTRS; i++)
+    {
+        db_pdu.len = proximity_shadow_attrs[i].len;
+        memcpy(db_pdu.pdu, &proximity_shadow[proximity_shadow_attrs[i].offset], db_pdu.len);
+        bleprofile_WriteHandle(proximity_shadow_attrs[i].handle, &db_pdu);
+    }
+}
+
+// Attribute written by the peer, mark it dirty if it is shadowed and changed
+void proximity_shadow_write(UINT16 handle, UINT8 *p, int len)
+{
+    UINT8 i;
+
+    for (i = 0; i < PROXIMITY_SHADOW_ATTRS; i++)
+    {
+        if (proximity_shadow_attrs[i].handle == handle)
+        {
+            UINT8 *p_value = &proximity_shadow[proximity_shadow_attrs[i].offset];
+
+            if ((len == proximity_shadow_attrs[i].len) && (memcmp(p_value, p, len) != 0))
+            {
+                memcpy(p_value, p, len);
+                proximity_shadow_dirty |= 1 << i;
+                proximity_timer_start(&proximity_shadow_timer, PROXIMITY_SHADOW_FLUSH_DELAY, 0,
+                                      PROXIMITY_SHADOW_FLUSH_SLACK, proximity_shadow_flush);
+            }
+            return;
+        }
+    }
+}
+
+void proximity_shadow_flush(void)
+{
+    proximity_timer_stop(&proximity_shadow_timer);
+
+    if (proximity_shadow_dirty)
+    {
+        ble_trace1("shadow flush dirty:%02x\n", proximity_shadow_dirty);
+
+        proximity_write_nvram(PROXIMITY_VS_ID_SHADOW, sizeof(proximity_shadow), proximity_shadow);
+        proximity_shadow_dirty = 0;
+    }
+}
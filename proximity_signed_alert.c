@@ -0,0 +1,388 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity signed Immediate Alert
+*
+* The Immediate Alert level is a write command that any device in range can
+* send.  This module adds an alert that is only accepted when it carries a
+* valid signature from a bonded client, in the format of the ATT Signed Write
+* Command signature: a sign counter followed by an AES-CMAC based MAC.
+*
+* The client provisions its signing key (CSRK) once per bond by writing it to
+* the signing key characteristic over an encrypted link to a bonded peer.
+* After that the client writes the signed alert characteristic with write
+* without response, without having to encrypt the link first
+*
+*  level (1), sign counter (4), MAC (8)
+*
+* MAC is the first 8 bytes of AES-CMAC(CSRK, 0xd2, handle (2), level, sign counter)
+* with the handle of the signed alert value, multi byte fields little endian.
+* The sign counter must be larger than the last one accepted from the bond.
+*
+* All signed messages are 8 bytes, shorter than an AES block, so CMAC always
+* uses the padded last block and the K2 subkey.  K2 is derived when the key is
+* provisioned or loaded and the AES key schedule of the connected bond is
+* expanded when the link comes up, verification costs one AES block.  The sign
+* counter is saved to NVRAM before an accepted alert is acted on, so the saved
+* counter is never behind an accepted one and no alert can be replayed after a
+* reset.  Only alerts with a valid MAC are saved, which a client sends at the
+* rate of the Immediate Alert rate limiter.
+*
+* Accepted alerts go through the Immediate Alert rate limiter like unsigned
+* writes.  With SIGNED_ALERT_REQUIRED=1 in the makefile unsigned writes to the
+* Immediate Alert level are ignored.
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+#define PROXIMITY_SIGNED_ALERT_MAX_BONDS        2
+
+#define PROXIMITY_SIGNED_ALERT_OPCODE           0xd2    // ATT Signed Write Command
+#define PROXIMITY_SIGNED_ALERT_MSG_SIZE         8
+#define PROXIMITY_SIGNED_ALERT_MAC_SIZE         8
+
+#define PROXIMITY_SIGNED_ALERT_ERR_INSUFFICIENT_AUTHENTICATION  0x05
+#define PROXIMITY_SIGNED_ALERT_ERR_PARAM                        0x81
+
+#define PROXIMITY_AES_BLOCK_SIZE                16
+#define PROXIMITY_AES_ROUNDS                    10
+#define PROXIMITY_AES_ROUND_KEYS_SIZE           (PROXIMITY_AES_BLOCK_SIZE * (PROXIMITY_AES_ROUNDS + 1))
+
+// Signing key of one bond, saved to NVRAM
+typedef struct
+{
+    UINT8   bd_addr[6];
+    UINT8   csrk[PROXIMITY_AES_BLOCK_SIZE];
+    UINT32  counter;                        // last sign counter accepted
+} PROXIMITY_SIGNING_KEY;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+PROXIMITY_SIGNING_KEY proximity_signing_keys[PROXIMITY_SIGNED_ALERT_MAX_BONDS];
+UINT8  proximity_signing_k2[PROXIMITY_SIGNED_ALERT_MAX_BONDS][PROXIMITY_AES_BLOCK_SIZE];
+
+// Key schedule of the bond of the connected peer
+UINT8  proximity_signing_round_keys[PROXIMITY_AES_ROUND_KEYS_SIZE];
+INT8   proximity_signing_peer = -1;
+
+UINT32 proximity_signed_alert_rejected;
+
+static const UINT8 proximity_aes_sbox[256] =
+{
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+static UINT8 proximity_aes_xtime(UINT8 x)
+{
+    return (x << 1) ^ ((x & 0x80) ? 0x1b : 0x00);
+}
+
+static void proximity_aes_expand_key(const UINT8 *key, UINT8 *round_keys)
+{
+    UINT8 rcon = 0x01;
+    UINT8 t[4];
+    UINT8 i;
+
+    memcpy(round_keys, key, PROXIMITY_AES_BLOCK_SIZE);
+
+    for (i = 4; i < 4 * (PROXIMITY_AES_ROUNDS + 1); i++)
+    {
+        memcpy(t, &round_keys[(i - 1) * 4], 4);
+        if ((i % 4) == 0)
+        {
+            UINT8 t0 = t[0];
+
+            t[0] = proximity_aes_sbox[t[1]] ^ rcon;
+            t[1] = proximity_aes_sbox[t[2]];
+            t[2] = proximity_aes_sbox[t[3]];
+            t[3] = proximity_aes_sbox[t0];
+            rcon = proximity_aes_xtime(rcon);
+        }
+        round_keys[i * 4 + 0] = round_keys[(i - 4) * 4 + 0] ^ t[0];
+        round_keys[i * 4 + 1] = round_keys[(i - 4) * 4 + 1] ^ t[1];
+        round_keys[i * 4 + 2] = round_keys[(i - 4) * 4 + 2] ^ t[2];
+        round_keys[i * 4 + 3] = round_keys[(i - 4) * 4 + 3] ^ t[3];
+    }
+}
+
+// Encrypt one block in place
+static void proximity_aes_encrypt(const UINT8 *round_keys, UINT8 *s)
+{
+    UINT8 round;
+    UINT8 i;
+    UINT8 t;
+
+    for (i = 0; i < PROXIMITY_AES_BLOCK_SIZE; i++)
+        s[i] ^= round_keys[i];
+
+    for (round = 1; round <= PROXIMITY_AES_ROUNDS; round++)
+    {
+        // SubBytes
+        for (i = 0; i < PROXIMITY_AES_BLOCK_SIZE; i++)
+            s[i] = proximity_aes_sbox[s[i]];
+
+        // ShiftRows, state is column major
+        t = s[1];  s[1]  = s[5];  s[5]  = s[9];  s[9]  = s[13]; s[13] = t;
+        t = s[2];  s[2]  = s[10]; s[10] = t;
+        t = s[6];  s[6]  = s[14]; s[14] = t;
+        t = s[15]; s[15] = s[11]; s[11] = s[7];  s[7]  = s[3];  s[3]  = t;
+
+        // MixColumns, skipped in the last round
+        if (round != PROXIMITY_AES_ROUNDS)
+        {
+            for (i = 0; i < PROXIMITY_AES_BLOCK_SIZE; i += 4)
+            {
+                UINT8 a0 = s[i], a1 = s[i + 1], a2 = s[i + 2], a3 = s[i + 3];
+                UINT8 all = a0 ^ a1 ^ a2 ^ a3;
+
+                s[i]     ^= all ^ proximity_aes_xtime(a0 ^ a1);
+                s[i + 1] ^= all ^ proximity_aes_xtime(a1 ^ a2);
+                s[i + 2] ^= all ^ proximity_aes_xtime(a2 ^ a3);
+                s[i + 3] ^= all ^ proximity_aes_xtime(a3 ^ a0);
+            }
+        }
+
+        for (i = 0; i < PROXIMITY_AES_BLOCK_SIZE; i++)
+            s[i] ^= round_keys[round * PROXIMITY_AES_BLOCK_SIZE + i];
+    }
+}
+
+// Shift block left by one bit, xor Rb if the top bit falls out (RFC 4493)
+static void proximity_cmac_double(const UINT8 *in, UINT8 *out)
+{
+    UINT8 carry = in[0] & 0x80;
+    UINT8 i;
+
+    for (i = 0; i < PROXIMITY_AES_BLOCK_SIZE - 1; i++)
+        out[i] = (in[i] << 1) | (in[i + 1] >> 7);
+    out[PROXIMITY_AES_BLOCK_SIZE - 1] = (in[PROXIMITY_AES_BLOCK_SIZE - 1] << 1) ^ (carry ? 0x87 : 0x00);
+}
+
+// Derive K2 subkey of the key
+static void proximity_cmac_k2(const UINT8 *key, UINT8 *k2)
+{
+    UINT8 round_keys[PROXIMITY_AES_ROUND_KEYS_SIZE];
+    UINT8 l[PROXIMITY_AES_BLOCK_SIZE];
+    UINT8 k1[PROXIMITY_AES_BLOCK_SIZE];
+
+    proximity_aes_expand_key(key, round_keys);
+    memset(l, 0, sizeof(l));
+    proximity_aes_encrypt(round_keys, l);
+    proximity_cmac_double(l, k1);
+    proximity_cmac_double(k1, k2);
+}
+
+// CMAC of a message shorter than one block, with precomputed K2
+static void proximity_cmac_short(const UINT8 *round_keys, const UINT8 *k2, const UINT8 *msg, UINT8 len, UINT8 *mac)
+{
+    UINT8 i;
+
+    memset(mac, 0, PROXIMITY_AES_BLOCK_SIZE);
+    memcpy(mac, msg, len);
+    mac[len] = 0x80;
+    for (i = 0; i < PROXIMITY_AES_BLOCK_SIZE; i++)
+        mac[i] ^= k2[i];
+    proximity_aes_encrypt(round_keys, mac);
+}
+
+static INT8 proximity_signed_alert_find_bond(UINT8 *bd_addr)
+{
+    INT8 i;
+
+    for (i = 0; i < PROXIMITY_SIGNED_ALERT_MAX_BONDS; i++)
+    {
+        if (memcmp(proximity_signing_keys[i].bd_addr, bd_addr, 6) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void proximity_signed_alert_save(void)
+{
+    proximity_write_nvram(PROXIMITY_VS_ID_SIGNING_KEYS, sizeof(proximity_signing_keys), (UINT8 *)proximity_signing_keys);
+}
+
+// Load signing keys and derive the subkeys
+void proximity_signed_alert_init(void)
+{
+    UINT8 i;
+
+    if (bleprofile_ReadNVRAM(PROXIMITY_VS_ID_SIGNING_KEYS, sizeof(proximity_signing_keys), (UINT8 *)proximity_signing_keys) != sizeof(proximity_signing_keys))
+    {
+        memset(proximity_signing_keys, 0, sizeof(proximity_signing_keys));
+    }
+
+    for (i = 0; i < PROXIMITY_SIGNED_ALERT_MAX_BONDS; i++)
+    {
+        proximity_cmac_k2(proximity_signing_keys[i].csrk, proximity_signing_k2[i]);
+    }
+}
+
+// Expand the key schedule of the connected peer if it provisioned a signing key
+void proximity_signed_alert_connection_up(void)
+{
+    proximity_signing_peer = proximity_signed_alert_find_bond(emconninfo_getPeerPubAddr());
+    if (proximity_signing_peer >= 0)
+    {
+        proximity_aes_expand_key(proximity_signing_keys[proximity_signing_peer].csrk, proximity_signing_round_keys);
+    }
+}
+
+void proximity_signed_alert_connection_down(void)
+{
+    proximity_signing_peer = -1;
+    memset(proximity_signing_round_keys, 0, sizeof(proximity_signing_round_keys));
+}
+
+static int proximity_signed_alert_set_key(UINT8 *key, int len)
+{
+    UINT8 *bd_addr = emconninfo_getPeerPubAddr();
+    INT8  i;
+
+    if (len != PROXIMITY_AES_BLOCK_SIZE)
+        return PROXIMITY_SIGNED_ALERT_ERR_PARAM;
+
+    // Key is stored against the peer address, which only identifies a bonded peer
+    if (!emconninfo_deviceBonded())
+        return PROXIMITY_SIGNED_ALERT_ERR_INSUFFICIENT_AUTHENTICATION;
+
+    // Replace key of the same peer, otherwise the oldest slot
+    if ((i = proximity_signed_alert_find_bond(bd_addr)) < 0)
+    {
+        memmove(&proximity_signing_keys[1], &proximity_signing_keys[0], sizeof(PROXIMITY_SIGNING_KEY) * (PROXIMITY_SIGNED_ALERT_MAX_BONDS - 1));
+        memmove(proximity_signing_k2[1], proximity_signing_k2[0], PROXIMITY_AES_BLOCK_SIZE * (PROXIMITY_SIGNED_ALERT_MAX_BONDS - 1));
+        i = 0;
+    }
+
+    memcpy(proximity_signing_keys[i].bd_addr, bd_addr, 6);
+    memcpy(proximity_signing_keys[i].csrk, key, PROXIMITY_AES_BLOCK_SIZE);
+    proximity_signing_keys[i].counter = 0;
+    proximity_cmac_k2(key, proximity_signing_k2[i]);
+    proximity_signed_alert_save();
+
+    proximity_signing_peer = i;
+    proximity_aes_expand_key(key, proximity_signing_round_keys);
+
+    ble_trace0("signed alert: key provisioned\n");
+    return 0;
+}
+
+static void proximity_signed_alert_write(UINT8 *data, int len)
+{
+    PROXIMITY_SIGNING_KEY *p_key;
+    UINT8  msg[PROXIMITY_SIGNED_ALERT_MSG_SIZE];
+    UINT8  mac[PROXIMITY_AES_BLOCK_SIZE];
+    UINT32 counter;
+
+    if ((len != 1 + 4 + PROXIMITY_SIGNED_ALERT_MAC_SIZE) || (proximity_signing_peer < 0))
+    {
+        proximity_signed_alert_rejected++;
+        return;
+    }
+    p_key   = &proximity_signing_keys[proximity_signing_peer];
+    counter = data[1] | (data[2] << 8) | (data[3] << 16) | (data[4] << 24);
+
+    // Replayed or reordered message
+    if (counter <= p_key->counter)
+    {
+        proximity_signed_alert_rejected++;
+        return;
+    }
+
+    msg[0] = PROXIMITY_SIGNED_ALERT_OPCODE;
+    msg[1] = (UINT8)HANDLE_PROX_SIGNED_ALERT_VALUE;
+    msg[2] = (UINT8)(HANDLE_PROX_SIGNED_ALERT_VALUE >> 8);
+    memcpy(&msg[3], data, 5);
+    proximity_cmac_short(proximity_signing_round_keys, proximity_signing_k2[proximity_signing_peer], msg, sizeof(msg), mac);
+
+    if (memcmp(mac, &data[5], PROXIMITY_SIGNED_ALERT_MAC_SIZE) != 0)
+    {
+        proximity_signed_alert_rejected++;
+        return;
+    }
+
+    // Save before the alert takes effect, a counter that was acted on is
+    // never accepted again, also not after a reset
+    p_key->counter = counter;
+    proximity_signed_alert_save();
+
+    proximity_ias_alert(data[0]);
+}
+
+// Process write to the signed alert service
+int proximity_signed_alert_write_handler(LEGATTDB_ENTRY_HDR *p)
+{
+    UINT16  handle   = legattdb_getHandle(p);
+    int     len      = legattdb_getAttrValueLen(p);
+    UINT8   *attrPtr = legattdb_getAttrValue(p);
+
+    switch (handle)
+    {
+    case HANDLE_PROX_SIGNED_ALERT_KEY_VALUE:
+        return proximity_signed_alert_set_key(attrPtr, len);
+
+    case HANDLE_PROX_SIGNED_ALERT_VALUE:
+        proximity_signed_alert_write(attrPtr, len);
+        return 0;
+    }
+    return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity sleep governor
+*
+* The low power manager asks the application how long the device may sleep
+* every time the system is idle.  The governor picks one of three states
+*  - pause      : CPU waits for interrupt, everything stays clocked
+*  - sleep      : clocks are stopped until a timer or the radio wakes the device
+*  - deep sleep : power off, the device restarts on a button press
+* from the time until the next application timer must run, the connection
+* interval when connected, and the cost of every state in the table below.
+* Deep sleep is only chosen when the device is neither connected nor
+* advertising, no alert is beeping or blinking, no application timer is armed
+* and the button is configured to wake the device.
+* A state is only chosen when the idle period is longer than its minimum
+* residency, the break even time after which the energy saved in the state
+* is larger than the energy spent entering and leaving it, plus its wake
+* latency.  The values are budgets for the fob hardware, calibrate them with
+* a current probe when the board changes.
+*
+* Time spent in every state is accounted between queries and included in the
+* metrics blob.
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "bleapputils.h"
+#include "devlpm.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      local definitions
+//////////////////////////////////////////////////////////////////////////////
+// Connection interval is in units of 1.25 msec
+#define PROXIMITY_CONN_INTERVAL_TO_USEC(i)      ((UINT32)(i) * 1250)
+
+typedef struct
+{
+    UINT32  wake_latency_us;            // from the wake up event until code runs
+    UINT32  min_residency_us;           // break even time of the state
+} PROXIMITY_SLEEP_COST;
+
+static const PROXIMITY_SLEEP_COST proximity_sleep_cost[PROXIMITY_SLEEP_MAX] =
+{
+    { 0,        0 },                    // PAUSE
+    { 2000,     5000 },                 // SLEEP, crystal start up
+    { 0,        0 },                    // DEEP_SLEEP, only when nothing is pending
+};
+
+typedef struct
+{
+    UINT32  entries;
+    UINT64  residency;                  // native clocks
+} PROXIMITY_SLEEP_STATS;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+UINT8  proximity_sleep_state;
+UINT32 proximity_sleep_clk;             // native clock of the last query
+PROXIMITY_SLEEP_STATS proximity_sleep_stats[PROXIMITY_SLEEP_MAX];
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+// Deepest state that pays off in the idle period, returns the sleep time allowed
+static UINT8 proximity_sleep_choose(UINT32 *p_sleep_us)
+{
+    UINT32 idle_us;
+
+    *p_sleep_us = 0;
+
+    // Queued events run as soon as the application thread gets the CPU
+    if (proximity_event_pending())
+        return PROXIMITY_SLEEP_PAUSE;
+
+    idle_us = proximity_timer_next_usec();
+
+    if (proximity_link_is_connected())
+    {
+        // Controller wakes up for every connection event, next one is at most an interval away
+        if (idle_us > PROXIMITY_CONN_INTERVAL_TO_USEC(emconinfo_getConnInterval()))
+            idle_us = PROXIMITY_CONN_INTERVAL_TO_USEC(emconinfo_getConnInterval());
+    }
+    else if ((bleprofile_GetDiscoverable() == NO_DISCOVERABLE) && !proximity_ias_alert_active() &&
+             !proximity_timer_armed() && proximity_gpio_wake_configured())
+    {
+        // Nothing to do until the user presses the button
+        return PROXIMITY_SLEEP_DEEP_SLEEP;
+    }
+
+    if (idle_us < proximity_sleep_cost[PROXIMITY_SLEEP_SLEEP].min_residency_us + proximity_sleep_cost[PROXIMITY_SLEEP_SLEEP].wake_latency_us)
+        return PROXIMITY_SLEEP_PAUSE;
+
+    // Wake early enough to be running when the deadline comes
+    *p_sleep_us = (idle_us == 0xffffffff) ? idle_us : idle_us - proximity_sleep_cost[PROXIMITY_SLEEP_SLEEP].wake_latency_us;
+    return PROXIMITY_SLEEP_SLEEP;
+}
+
+// Low power manager query
+static UINT32 proximity_sleep_query(LowPowerModePollType type, UINT32 context)
+{
+    UINT32 now = bleapputils_currentNativeBtClk();
+    UINT32 sleep_us;
+
+    if (type == LOW_POWER_MODE_POLL_TYPE_POWER_OFF)
+    {
+        return proximity_sleep_state == PROXIMITY_SLEEP_DEEP_SLEEP;
+    }
+
+    // Time since the last query was spent in the state chosen then
+    proximity_sleep_stats[proximity_sleep_state].residency += bleapputils_diffNativeBtClks(proximity_sleep_clk, now);
+    proximity_sleep_clk = now;
+
+    proximity_sleep_state = proximity_sleep_choose(&sleep_us);
+    proximity_sleep_stats[proximity_sleep_state].entries++;
+
+    return sleep_us;
+}
+
+void proximity_sleep_init(void)
+{
+    proximity_sleep_clk = bleapputils_currentNativeBtClk();
+    devlpm_registerForLowPowerQueries(proximity_sleep_query, 0);
+}
+
+void proximity_sleep_add_metrics(PROXIMITY_TLV_WRITER *p_tlv)
+{
+    UINT8 *p = proximity_tlv_add(p_tlv, PROXIMITY_TLV_SLEEP, PROXIMITY_TLV_SLEEP_SIZE);
+    UINT8 state;
+
+    if (p == NULL)
+        return;
+
+    for (state = 0; state < PROXIMITY_SLEEP_MAX; state++, p += 8)
+    {
+        proximity_tlv_put32(&p[0], proximity_sleep_stats[state].entries);
+        proximity_tlv_put32(&p[4], (UINT32)PROXIMITY_NATIVE_CLKS_TO_MSEC(proximity_sleep_stats[state].residency));
+    }
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2021-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+*
+* LE Proximity application timers
+*
+* Periodic and one shot work of the application modules runs from timers
+* driven by the one second application timer instead of each module testing
+* the timer count on its own.  Every timer has a slack: a timer that is due
+* may run up to slack seconds late.  A timer only forces work when its slack
+* runs out, and then every other timer that is already due runs with it, so
+* that the work of many timers is batched on few ticks and the device stays in
+* sleep on the ticks in between.
+*
+* Timers are allocated by their owners and linked in a list.  The earliest
+* tick at which some timer must run is cached, ticks before that return
+* without walking the list.
+*
+*/
+
+#include "bleprofile.h"
+#include "bleapp.h"
+#include "bleapputils.h"
+#include "string.h"
+#include "proximity.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//                      global variables
+//////////////////////////////////////////////////////////////////////////////
+PROXIMITY_TIMER *proximity_timer_list;
+UINT32 proximity_timer_now;
+UINT32 proximity_timer_next_forced = 0xffffffff;
+UINT32 proximity_timer_tick_clk;        // native clock of the last tick
+
+// Ticks seen, ticks on which timers ran, timers run
+UINT32 proximity_timer_ticks;
+UINT32 proximity_timer_wakeups;
+UINT32 proximity_timer_expiries;
+
+//////////////////////////////////////////////////////////////////////////////
+//                      function definitions
+//////////////////////////////////////////////////////////////////////////////
+static void proximity_timer_update_next(void)
+{
+    PROXIMITY_TIMER *p_timer;
+
+    proximity_timer_next_forced = 0xffffffff;
+    for (p_timer = proximity_timer_list; p_timer != NULL; p_timer = p_timer->next)
+    {
+        if (p_timer->deadline + p_timer->slack < proximity_timer_next_forced)
+            proximity_timer_next_forced = p_timer->deadline + p_timer->slack;
+    }
+}
+
+// Start or restart the timer.  Callback runs delay seconds from now, at most
+// slack seconds later, and then every period seconds unless period is 0.
+void proximity_timer_start(PROXIMITY_TIMER *p_timer, UINT16 delay, UINT16 period, UINT16 slack, void (*cb)(void))
+{
+    proximity_timer_stop(p_timer);
+
+    p_timer->deadline = proximity_timer_now + delay;
+    p_timer->period   = period;
+    p_timer->slack    = slack;
+    p_timer->cb       = cb;
+    p_timer->next     = proximity_timer_list;
+    proximity_timer_list = p_timer;
+
+    if (p_timer->deadline + slack < proximity_timer_next_forced)
+        proximity_timer_next_forced = p_timer->deadline + slack;
+}
+
+void proximity_timer_stop(PROXIMITY_TIMER *p_timer)
+{
+    PROXIMITY_TIMER **pp;
+
+    for (pp = &proximity_timer_list; *pp != NULL; pp = &(*pp)->next)
+    {
+        if (*pp == p_timer)
+        {
+            *pp = p_timer->next;
+            p_timer->next = NULL;
+            proximity_timer_update_next();
+            return;
+        }
+    }
+}
+
+// Microseconds until a timer must run, 0xffffffff if none is running
+UINT32 proximity_timer_next_usec(void)
+{
+    UINT32 elapsed;
+    UINT32 seconds;
+
+    if (proximity_timer_next_forced == 0xffffffff)
+        return 0xffffffff;
+
+    if (proximity_timer_next_forced <= proximity_timer_now)
+        return 0;
+
+    elapsed = PROXIMITY_NATIVE_CLKS_TO_USEC(bleapputils_diffNativeBtClks(proximity_timer_tick_clk, bleapputils_currentNativeBtClk()));
+    seconds = proximity_timer_next_forced - proximity_timer_now;
+    if (seconds > 4000)
+        return 0xffffffff - 1;
+
+    return (seconds * 1000000 > elapsed) ? seconds * 1000000 - elapsed : 0;
+}
+
+// TRUE if any timer is running, its work would be lost at power off
+BOOL32 proximity_timer_armed(void)
+{
+    return proximity_timer_list != NULL;
+}
+
+// One second tick
+void proximity_timer_timeout(void)
+{
+    PROXIMITY_TIMER *p_timer;
+    PROXIMITY_TIMER *p_next;
+
+    proximity_timer_now++;
+    proximity_timer_ticks++;
+    proximity_timer_tick_clk = bleapputils_currentNativeBtClk();
+
+    if (proximity_timer_now < proximity_timer_next_forced)
+        return;
+
+    proximity_timer_wakeups++;
+
+    // Run everything that is due.  A callback may start or stop timers, the
+    // list is walked again after every callback.
+    do
+    {
+        for (p_timer = proximity_timer_list; p_timer != NULL; p_timer = p_next)
+        {
+            p_next = p_timer->next;
+            if (p_timer->deadline <= proximity_timer_now)
+                break;
+        }
+
+        if (p_timer != NULL)
+        {
+            if (p_timer->period != 0)
+            {
+                // next run is relative to the deadline, not to the late run
+                while (p_timer->deadline <= proximity_timer_now)
+                    p_timer->deadline += p_timer->period;
+            }
+            else
+            {
+                proximity_timer_stop(p_timer);
+            }
+
+            proximity_timer_expiries++;
+            p_timer->cb();
+        }
+    } while (p_timer != NULL);
+
+    proximity_timer_update_next();
+}
+
+void proximity_timer_add_metrics(PROXIMITY_TLV_WRITER *p_tlv)
+{
+    UINT8 *p = proximity_tlv_add(p_tlv, PROXIMITY_TLV_TIMER, PROXIMITY_TLV_TIMER_SIZE);
+
+    if (p != NULL)
+    {
+        proximity_tlv_put32(&p[0], proximity_timer_ticks);
+        proximity_tlv_put32(&p[4], proximity_timer_wakeups);
+        proximity_tlv_put32(&p[8], proximity_timer_expiries);
+    }
+}